@@ -0,0 +1,86 @@
+#include "boot_trace.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+static const char *TAG = "BOOT_TRACE";
+
+static int64_t stamps[BOOT_TRACE_COUNT];
+
+static const char *const names[BOOT_TRACE_COUNT] = {
+    [BOOT_APP_START]      = "app start",
+    [BOOT_I2C_READY]      = "i2c bus",
+    [BOOT_LED_READY]      = "tlc59108 init",
+    [BOOT_NVS_READY]      = "nvs init",
+    [BOOT_STATE_LOADED]   = "state loaded",
+    [BOOT_LIGHT_ON]       = "light on",
+    [BOOT_ZB_PLATFORM]    = "zb platform config",
+    [BOOT_ZB_TASK]        = "zb task start",
+    [BOOT_ZB_REGISTERED]  = "zb device registered",
+    [BOOT_ZB_STARTED]     = "zb stack started",
+    [BOOT_BDB_INIT]       = "bdb init",
+    [BOOT_BDB_DONE]       = "bdb first start/reboot",
+    [BOOT_STEERING]       = "steering start",
+    [BOOT_JOINED]         = "network up",
+    [BOOT_ANIMATION_DONE] = "boot animation",
+    [BOOT_TC74_READY]     = "tc74 init",
+    [BOOT_MS8607_READY]   = "ms8607 prom",
+    [BOOT_SENSORS_READY]  = "sensors ready",
+};
+
+void boot_trace_mark(boot_phase_t phase)
+{
+    if (phase >= BOOT_TRACE_COUNT || stamps[phase] != 0) return;
+    stamps[phase] = esp_timer_get_time();
+}
+
+int64_t boot_trace_get(boot_phase_t phase)
+{
+    return phase < BOOT_TRACE_COUNT ? stamps[phase] : 0;
+}
+
+const char *boot_trace_name(boot_phase_t phase)
+{
+    return phase < BOOT_TRACE_COUNT ? names[phase] : "?";
+}
+
+void boot_trace_print(void)
+{
+    // Checkpoints come from several tasks, so list them in time order
+    uint8_t order[BOOT_TRACE_COUNT];
+    int count = 0;
+    for (int i = 0; i < BOOT_TRACE_COUNT; i++) {
+        int j = count++;
+        // Unreached checkpoints (0) go last, in enum order
+        while (j > 0 && stamps[i] != 0 && (stamps[order[j - 1]] == 0 || stamps[order[j - 1]] > stamps[i])) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = (uint8_t)i;
+    }
+
+    int64_t prev = 0;
+    ESP_LOGI(TAG, "%-24s %8s %8s", "phase", "at ms", "+ms");
+    for (int k = 0; k < count; k++) {
+        int i = order[k];
+        if (stamps[i] == 0) {
+            ESP_LOGI(TAG, "%-24s %8s %8s", names[i], "-", "-");
+            continue;
+        }
+        ESP_LOGI(TAG, "%-24s %8lld %8lld", names[i], (long long)(stamps[i] / 1000), (long long)((stamps[i] - prev) / 1000));
+        prev = stamps[i];
+    }
+}
+
+size_t boot_trace_export(uint8_t *buf, size_t size)
+{
+    size_t n = 0;
+
+    for (int i = 0; i < BOOT_TRACE_COUNT && n + 4 <= size; i++) {
+        uint32_t ms = (uint32_t)(stamps[i] / 1000);
+        buf[n++] = ms & 0xFF;
+        buf[n++] = (ms >> 8) & 0xFF;
+        buf[n++] = (ms >> 16) & 0xFF;
+        buf[n++] = (ms >> 24) & 0xFF;
+    }
+    return n;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Boot timeline: each checkpoint keeps the esp_timer time (us since app start) of its first mark.
+// Marking is a single store, cheap enough for any task or driver init path.
+typedef enum {
+    BOOT_APP_START,
+    BOOT_I2C_READY,
+    BOOT_LED_READY,
+    BOOT_NVS_READY,
+    BOOT_STATE_LOADED,
+    BOOT_LIGHT_ON,
+    BOOT_ZB_PLATFORM,
+    BOOT_ZB_TASK,
+    BOOT_ZB_REGISTERED,
+    BOOT_ZB_STARTED,
+    BOOT_BDB_INIT,
+    BOOT_BDB_DONE,
+    BOOT_STEERING,
+    BOOT_JOINED,
+    BOOT_ANIMATION_DONE,
+    BOOT_TC74_READY,
+    BOOT_MS8607_READY,
+    BOOT_SENSORS_READY,
+    BOOT_TRACE_COUNT
+} boot_phase_t;
+
+void boot_trace_mark(boot_phase_t phase);
+
+// Microseconds since app start, 0 if the checkpoint was not reached (yet)
+int64_t boot_trace_get(boot_phase_t phase);
+
+const char *boot_trace_name(boot_phase_t phase);
+
+// Log the timeline as a table: absolute time and the gap to the previous reached checkpoint
+void boot_trace_print(void);
+
+// Pack the timeline as little-endian uint32 milliseconds, one per phase in enum order
+// (0 = not reached). Returns the bytes written.
+size_t boot_trace_export(uint8_t *buf, size_t size);
@@ -3,6 +3,12 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_check.h"
+#include "esp_timer.h"
+#include "esp_mac.h"
+#include "esp_cpu.h"
+#include "nvs.h"
+#include "boot_trace.h"
+#include "sensor_sched.h"
 #include <string.h>
 #define TAG "MS8607"
 
@@ -13,26 +19,36 @@
 // PT commands (MS5637-like)
 #define PT_CMD_RESET        0x1E
 #define PT_CMD_ADC_READ    0x00
-#define PT_CMD_CONV_D2     0x58    // temperature, OSR=4096
+#define PT_CMD_CONV_D1     0x40    // pressure, + 2 * OSR index
+#define PT_CMD_CONV_D2     0x50    // temperature, + 2 * OSR index
 #define PT_CMD_PROM_BASE   0xA0
 
 // RH commands (HTU21D-like)
 #define RH_CMD_SOFT_RESET  0xFE
 #define RH_CMD_TRIG_RH     0xF5
+#define RH_CMD_WRITE_USER  0xE6
+#define RH_CMD_READ_USER   0xE7
+#define RH_USER_RES_MASK   0x81    // resolution bits 7 and 0
+
+#define PROM_READ_ATTEMPTS 2
 
 static i2c_master_dev_handle_t pt_dev = NULL;
 static i2c_master_dev_handle_t rh_dev = NULL;
 
 static uint16_t prom[8];
+static ms8607_stats_t stats;
 
 // ---------------- CRC4 for PROM ----------------
-static uint8_t crc4(uint16_t *n_prom)
+// MS8607 layout: the CRC sits in bits 15..12 of word 0 and covers words
+// 0..6 (word 7 does not exist and counts as 0).
+static uint8_t crc4(const uint16_t *words)
 {
-    uint16_t n_rem = 0;
-    uint16_t crc_read = n_prom[7] & 0x000F;
-
-    n_prom[7] &= 0xFFF0;
+    uint16_t n_prom[8];
+    memcpy(n_prom, words, 7 * sizeof(uint16_t));
+    n_prom[0] &= 0x0FFF;
+    n_prom[7] = 0;
 
+    uint16_t n_rem = 0;
     for (int cnt = 0; cnt < 16; cnt++) {
         n_rem ^= (cnt & 1) ? (n_prom[cnt >> 1] & 0x00FF)
                            : (n_prom[cnt >> 1] >> 8);
@@ -41,125 +57,328 @@ static uint8_t crc4(uint16_t *n_prom)
                                      : (n_rem << 1);
         }
     }
-
-    n_prom[7] |= crc_read;
     return (n_rem >> 12) & 0xF;
 }
 
+bool ms8607_prom_valid(const uint16_t *words)
+{
+    return crc4(words) == (words[0] >> 12);
+}
+
 // ---------------- PT helpers ----------------
-static esp_err_t pt_read_prom_first(void)
+static esp_err_t pt_read_prom_word(int i, uint16_t *word)
 {
-    for (int i = 0; i < 8; i++) {
-        uint8_t cmd = PT_CMD_PROM_BASE + (i * 2);
-        uint8_t rx[2];
-        ESP_LOGI(TAG, "%i : Reading PROM cmd 0x%02X", i, cmd);
-        esp_err_t ret = i2c_master_transmit(pt_dev, &cmd, 1, -1);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "PROM cmd 0x%02X write failed: %s", cmd, esp_err_to_name(ret));
-            return ret;
-        }
+    // Command and read in one transaction (repeated start), no settle time needed
+    uint8_t cmd = PT_CMD_PROM_BASE + (i * 2);
+    uint8_t rx[2];
+    ESP_RETURN_ON_ERROR(
+        i2c_master_transmit_receive(pt_dev, &cmd, 1, rx, 2, -1),
+        TAG, "PROM cmd 0x%02X read failed", cmd
+    );
 
-        // Some boards/devices need a tiny settle time between STOP and next START
-        vTaskDelay(pdMS_TO_TICKS(1));
+    *word = (rx[0] << 8) | rx[1];
+    return ESP_OK;
+}
 
-        ret = i2c_master_receive(pt_dev, rx, 2, -1);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "PROM cmd 0x%02X read failed: %s", cmd, esp_err_to_name(ret));
-            return ret;
+static esp_err_t pt_read_prom(void)
+{
+    for (int attempt = 0; attempt < PROM_READ_ATTEMPTS; attempt++) {
+        for (int i = 0; i < 7; i++) {
+            ESP_RETURN_ON_ERROR(pt_read_prom_word(i, &prom[i]), TAG, "PROM read failed");
         }
+        prom[7] = 0;
+        if (ms8607_prom_valid(prom)) return ESP_OK;
 
-        prom[i] = (rx[0] << 8) | rx[1];
-    }
-    /*
-    uint16_t prom_copy[8];
-    memcpy(prom_copy, prom, sizeof(prom));
-    if (crc4(prom_copy) != (prom[7] & 0xF)) {
-        ESP_LOGE(TAG, "PROM CRC mismatch");
-        return ESP_FAIL;
+        stats.crc_failures++;
+        ESP_LOGW(TAG, "PROM CRC mismatch (attempt %d)", attempt + 1);
     }
-    */
-
-    return ESP_OK;
+    return ESP_ERR_INVALID_CRC;
 }
 
-static uint16_t prom[8];
-
-static esp_err_t pt_read_prom(void)
+// ---------------- PROM cache ----------------
+// The coefficients never change for a given part, so they are kept in NVS.
+// The cache is only used when it was written on this board for this
+// address, still passes its CRC, and the part still reports the same
+// word 0 (factory bits and CRC), which catches a swapped sensor for the
+// cost of one word read instead of seven.
+#define PROM_NAMESPACE      "storage"
+#define PROM_KEY            "ms8607_prom"
+#define PROM_VERSION        1
+
+// Stored as raw bytes, so the padding before read_us is spelled out
+typedef struct {
+    uint8_t version;
+    uint8_t addr;
+    uint8_t mac[6];
+    uint16_t words[7];
+    uint8_t reserved[2];
+    uint32_t read_us;      // duration of the full read that filled the cache
+} prom_cache_t;
+_Static_assert(sizeof(prom_cache_t) == 28, "prom_cache_t must not contain implicit padding");
+
+static void prom_cache_fingerprint(prom_cache_t *cache)
 {
-    for (int i = 0; i < 7; i++) {                 // <-- ONLY 7 words
-        uint8_t cmd = PT_CMD_PROM_BASE + (i * 2); // 0xA0 .. 0xAC
-        uint8_t rx[2];
-
-        ESP_LOGI(TAG, "%d : Reading PROM cmd 0x%02X", i, cmd);
+    memset(cache, 0, sizeof(*cache));
+    cache->version = PROM_VERSION;
+    cache->addr = MS8607_ADDR_PT;
+    esp_read_mac(cache->mac, ESP_MAC_BASE);
+}
 
-        esp_err_t ret = i2c_master_transmit(pt_dev, &cmd, 1, -1);
-        if (ret != ESP_OK) return ret;
+static bool prom_cache_load(void)
+{
+    prom_cache_t want, cache;
+    prom_cache_fingerprint(&want);
+
+    nvs_handle_t handle;
+    if (nvs_open(PROM_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return false;
+    size_t size = sizeof(cache);
+    esp_err_t err = nvs_get_blob(handle, PROM_KEY, &cache, &size);
+    nvs_close(handle);
+
+    if (err != ESP_OK || size != sizeof(cache) || cache.version != want.version ||
+        cache.addr != want.addr || memcmp(cache.mac, want.mac, sizeof(want.mac)) != 0) {
+        return false;
+    }
+    if (!ms8607_prom_valid(cache.words)) {
+        stats.crc_failures++;
+        ESP_LOGW(TAG, "Cached PROM fails CRC, re-reading");
+        return false;
+    }
 
-        vTaskDelay(pdMS_TO_TICKS(1));
+    uint16_t word0;
+    if (pt_read_prom_word(0, &word0) != ESP_OK || word0 != cache.words[0]) {
+        ESP_LOGW(TAG, "Sensor does not match cached PROM, re-reading");
+        return false;
+    }
 
-        ret = i2c_master_receive(pt_dev, rx, 2, -1);
-        if (ret != ESP_OK) return ret;
+    memcpy(prom, cache.words, sizeof(cache.words));
+    prom[7] = 0;
+    stats.prom_read_us = cache.read_us;
+    return true;
+}
 
-        prom[i] = (rx[0] << 8) | rx[1];
+static void prom_cache_store(uint32_t read_us)
+{
+    prom_cache_t cache;
+    prom_cache_fingerprint(&cache);
+    memcpy(cache.words, prom, sizeof(cache.words));
+    cache.read_us = read_us;
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(PROM_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, PROM_KEY, &cache, sizeof(cache));
+        if (err == ESP_OK) err = nvs_commit(handle);
+        nvs_close(handle);
     }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Caching PROM failed: %s", esp_err_to_name(err));
+    }
+}
 
-    prom[7] = 0; // datasheet CRC code expects this as subsidiary value :contentReference[oaicite:3]{index=3}
-
-    // CRC check below...
+static esp_err_t prom_load(void)
+{
+    int64_t start = esp_timer_get_time();
+    stats.prom_cached = prom_cache_load();
+    if (!stats.prom_cached) {
+        ESP_RETURN_ON_ERROR(pt_read_prom(), TAG, "PROM unusable");
+        stats.prom_read_us = (uint32_t)(esp_timer_get_time() - start);
+        prom_cache_store(stats.prom_read_us);
+    }
+    stats.prom_load_us = (uint32_t)(esp_timer_get_time() - start);
+
+    if (stats.prom_cached) {
+        ESP_LOGI(TAG, "PROM from cache in %lu us (full read %lu us)",
+                 (unsigned long)stats.prom_load_us, (unsigned long)stats.prom_read_us);
+    } else {
+        ESP_LOGI(TAG, "PROM read and cached in %lu us, %lu CRC failures",
+                 (unsigned long)stats.prom_load_us, (unsigned long)stats.crc_failures);
+    }
     return ESP_OK;
 }
 
+// ---------------- Compensation ----------------
+// Datasheet first- and second-order compensation, integer only (no FPU on
+// the C6). Shifts rather than divisions, as in the reference code, so the
+// rounding of negative intermediates matches the datasheet vectors.
+void ms8607_compensate_pt(const uint16_t c[8], uint32_t d1, uint32_t d2,
+                          int32_t *temperature, int32_t *pressure)
+{
+    int32_t dT   = (int32_t)d2 - ((int32_t)c[5] << 8);
+    int32_t TEMP = 2000 + (int32_t)(((int64_t)dT * c[6]) >> 23);
+    int64_t OFF  = ((int64_t)c[2] << 17) + (((int64_t)c[4] * dT) >> 6);
+    int64_t SENS = ((int64_t)c[1] << 16) + (((int64_t)c[3] * dT) >> 7);
+
+    int64_t T2, OFF2, SENS2;
+    if (TEMP < 2000) {
+        int64_t low = (int64_t)(TEMP - 2000) * (TEMP - 2000);
+        T2    = (3 * (int64_t)dT * dT) >> 33;
+        OFF2  = 61 * low / 16;
+        SENS2 = 29 * low / 16;
+        if (TEMP < -1500) {
+            int64_t very_low = (int64_t)(TEMP + 1500) * (TEMP + 1500);
+            OFF2  += 17 * very_low;
+            SENS2 += 9 * very_low;
+        }
+    } else {
+        T2    = (5 * (int64_t)dT * dT) >> 38;
+        OFF2  = 0;
+        SENS2 = 0;
+    }
 
+    OFF  -= OFF2;
+    SENS -= SENS2;
+    *temperature = TEMP - (int32_t)T2;
+    *pressure    = (int32_t)((((int64_t)d1 * SENS >> 21) - OFF) >> 15);
+}
 
-
-static esp_err_t pt_read_temperature(float *temp_c)
+int32_t ms8607_compensate_rh(uint16_t raw, int32_t temperature)
 {
-    uint8_t cmd = PT_CMD_CONV_D2;
-    ESP_RETURN_ON_ERROR(
-        i2c_master_transmit(pt_dev, &cmd, 1, -1),
-        TAG, "PT conv start failed"
-    );
+    raw &= ~0x3;    // status bits
+    int32_t rh = -600 + (int32_t)(((int64_t)12500 * raw) >> 16);
+    // Temperature coefficient -0.18 %RH/K around 20 C
+    rh += (2000 - temperature) * -18 / 100;
+    if (rh < 0) rh = 0;
+    if (rh > 10000) rh = 10000;
+    return rh;
+}
 
-    vTaskDelay(pdMS_TO_TICKS(10));
+// ---------------- Conversion state ----------------
+// The PT die and the RH die are separate I2C devices with their own ADCs,
+// so the RH measurement runs while the PT die converts D2 then D1 (one ADC,
+// so those two are sequential). Neither part can be asked whether it is
+// done without stretching or NACKing the bus, so readiness is judged from
+// the datasheet worst-case conversion times instead of by polling them.
+typedef enum {
+    MS_IDLE,
+    MS_CONV_D2,     // temperature converting, RH converting
+    MS_CONV_D1,     // D2 collected, pressure converting
+} ms_state_t;
+
+// Datasheet worst-case conversion times, indexed by ms8607_osr_t / ms8607_rh_res_t
+static const uint16_t pt_conv_us[] = { 600, 1170, 2280, 4540, 9040, 18080 };
+static const uint16_t rh_conv_us[] = { 16000, 3000, 5000, 9000 };
+
+static ms_state_t ms_state = MS_IDLE;
+static int64_t pt_due_us;
+static int64_t rh_due_us;
+static uint32_t raw_d2;
+
+// Resolution: requested for the next sample, applied to the one converting
+static ms8607_osr_t osr = MS8607_PRECISE_OSR;
+static ms8607_rh_res_t rh_res = MS8607_PRECISE_RH;
+static ms8607_osr_t sample_osr;
+static int rh_res_applied = -1;     // RH user register setting, -1 unknown
+static bool adaptive = true;
+
+static ms8607_reading_t last;
+static bool have_last;
+static uint8_t stable_samples;
+
+static int64_t sample_bus_us;
+
+static esp_err_t pt_start(uint8_t cmd)
+{
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = i2c_master_transmit(pt_dev, &cmd, 1, -1);
+    sample_bus_us += esp_timer_get_time() - t0;
+    return ret;
+}
 
-    cmd = PT_CMD_ADC_READ;
+static esp_err_t pt_read_adc(uint32_t *adc)
+{
+    uint8_t cmd = PT_CMD_ADC_READ;
     uint8_t rx[3];
-    ESP_RETURN_ON_ERROR(
-        i2c_master_transmit_receive(pt_dev, &cmd, 1, rx, 3, -1),
-        TAG, "PT ADC read failed"
-    );
-
-    uint32_t D2 = (rx[0] << 16) | (rx[1] << 8) | rx[2];
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = i2c_master_transmit_receive(pt_dev, &cmd, 1, rx, 3, -1);
+    sample_bus_us += esp_timer_get_time() - t0;
+    ESP_RETURN_ON_ERROR(ret, TAG, "PT ADC read failed");
 
-    int32_t dT = D2 - ((int32_t)prom[5] << 8);
-    int32_t TEMP = 2000 + ((int64_t)dT * prom[6]) / (1LL << 23);
-
-    *temp_c = TEMP / 100.0f;
+    *adc = ((uint32_t)rx[0] << 16) | (rx[1] << 8) | rx[2];
     return ESP_OK;
 }
 
 // ---------------- RH helpers ----------------
-static esp_err_t rh_read(float *rh)
+// No-hold-master trigger: the RH die releases the bus while it converts.
+static esp_err_t rh_start(void)
 {
     uint8_t cmd = RH_CMD_TRIG_RH;
-    ESP_RETURN_ON_ERROR(
-        i2c_master_transmit(rh_dev, &cmd, 1, -1),
-        TAG, "RH trigger failed"
-    );
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = i2c_master_transmit(rh_dev, &cmd, 1, -1);
+    sample_bus_us += esp_timer_get_time() - t0;
+    return ret;
+}
+
+// Read-modify-write of the user register, only when the resolution changes
+static esp_err_t rh_apply_resolution(ms8607_rh_res_t res)
+{
+    if (rh_res_applied == (int)res) return ESP_OK;
+
+    uint8_t cmd = RH_CMD_READ_USER;
+    uint8_t user;
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = i2c_master_transmit_receive(rh_dev, &cmd, 1, &user, 1, -1);
+    if (ret == ESP_OK) {
+        user &= ~RH_USER_RES_MASK;
+        user |= ((res & 0x2) << 6) | (res & 0x1);
+        uint8_t tx[2] = { RH_CMD_WRITE_USER, user };
+        ret = i2c_master_transmit(rh_dev, tx, 2, -1);
+    }
+    sample_bus_us += esp_timer_get_time() - t0;
+    ESP_RETURN_ON_ERROR(ret, TAG, "RH resolution write failed");
 
-    vTaskDelay(pdMS_TO_TICKS(20));
+    rh_res_applied = res;
+    return ESP_OK;
+}
 
+static esp_err_t rh_read_raw(uint16_t *raw)
+{
     uint8_t rx[3];
-    ESP_RETURN_ON_ERROR(
-        i2c_master_receive(rh_dev, rx, 3, -1),
-        TAG, "RH read failed"
-    );
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = i2c_master_receive(rh_dev, rx, 3, -1);
+    sample_bus_us += esp_timer_get_time() - t0;
+    ESP_RETURN_ON_ERROR(ret, TAG, "RH read failed");
 
-    uint16_t raw = ((rx[0] << 8) | rx[1]) & ~0x3;
-    *rh = -6.0f + 125.0f * ((float)raw / 65536.0f);
+    *raw = (rx[0] << 8) | rx[1];
     return ESP_OK;
 }
 
+// ---------------- Adaptive resolution ----------------
+static bool moved(int32_t a, int32_t b, int32_t noise)
+{
+    return a - b > noise || b - a > noise;
+}
+
+// Any change above the noise floor returns to full resolution straight
+// away; the fast mode is only entered after a run of quiet samples.
+static void adapt_resolution(const ms8607_reading_t *r)
+{
+    if (!adaptive) return;
+
+    bool changed = !have_last ||
+                   moved(r->temperature, last.temperature, MS8607_NOISE_TEMP) ||
+                   moved(r->pressure, last.pressure, MS8607_NOISE_PRESSURE) ||
+                   moved(r->humidity, last.humidity, MS8607_NOISE_RH);
+    if (changed) {
+        stable_samples = 0;
+    } else if (stable_samples < MS8607_STABLE_SAMPLES) {
+        stable_samples++;
+    }
+
+    ms8607_osr_t next_osr = MS8607_PRECISE_OSR;
+    ms8607_rh_res_t next_rh = MS8607_PRECISE_RH;
+    if (stable_samples >= MS8607_STABLE_SAMPLES) {
+        next_osr = MS8607_FAST_OSR;
+        next_rh = MS8607_FAST_RH;
+    }
+    if (next_osr != osr || next_rh != rh_res) {
+        ESP_LOGD(TAG, "resolution -> OSR %d, RH %d", 256 << next_osr, next_rh);
+        stats.mode_switches++;
+    }
+    osr = next_osr;
+    rh_res = next_rh;
+}
+
 // ---------------- Public API ----------------
 esp_err_t ms8607_init(i2c_master_bus_handle_t bus)
 {
@@ -184,15 +403,186 @@ esp_err_t ms8607_init(i2c_master_bus_handle_t bus)
     ESP_LOGI(TAG, "PT reset ret=%s", esp_err_to_name(ret));
     if (ret != ESP_OK) return ret;
 
-    vTaskDelay(pdMS_TO_TICKS(3));
-    ESP_LOGI(TAG, "OK her");
-    return pt_read_prom();
+    // 2.8 ms reload; +1 tick because pdMS_TO_TICKS(3) is 0 at 100 Hz
+    vTaskDelay(pdMS_TO_TICKS(3) + 1);
+    ret = prom_load();
+    if (ret == ESP_OK) boot_trace_mark(BOOT_MS8607_READY);
+    return ret;
+}
+
+
+esp_err_t ms8607_start(void)
+{
+    if (ms_state != MS_IDLE) return ESP_ERR_INVALID_STATE;
+
+    sample_bus_us = 0;
+    sample_osr = osr;
+    ESP_RETURN_ON_ERROR(rh_apply_resolution(rh_res), TAG, "RH config failed");
+
+    ESP_RETURN_ON_ERROR(pt_start(PT_CMD_CONV_D2 + 2 * sample_osr), TAG, "PT conv start failed");
+    pt_due_us = esp_timer_get_time() + pt_conv_us[sample_osr];
+
+    ESP_RETURN_ON_ERROR(rh_start(), TAG, "RH trigger failed");
+    rh_due_us = esp_timer_get_time() + rh_conv_us[rh_res_applied];
+
+    ms_state = MS_CONV_D2;
+    return ESP_OK;
+}
+
+esp_err_t ms8607_poll(uint32_t *remaining_us)
+{
+    if (ms_state == MS_IDLE) return ESP_ERR_INVALID_STATE;
+
+    int64_t now = esp_timer_get_time();
+    if (ms_state == MS_CONV_D2 && now >= pt_due_us) {
+        // Hand the PT ADC over to the pressure conversion
+        esp_err_t ret = pt_read_adc(&raw_d2);
+        if (ret == ESP_OK) ret = pt_start(PT_CMD_CONV_D1 + 2 * sample_osr);
+        if (ret != ESP_OK) {
+            ms_state = MS_IDLE;
+            return ret;
+        }
+        now = esp_timer_get_time();
+        pt_due_us = now + pt_conv_us[sample_osr];
+        ms_state = MS_CONV_D1;
+    }
+
+    // While D2 converts, the next step is the handover above, not the end of
+    // the sample: wake the caller for that so D1 starts without delay.
+    int64_t due;
+    if (ms_state == MS_CONV_D2) {
+        due = pt_due_us;
+    } else {
+        due = pt_due_us > rh_due_us ? pt_due_us : rh_due_us;
+    }
+    int64_t left = due - now;
+    if (remaining_us) *remaining_us = left > 0 ? (uint32_t)left : 0;
+    return left > 0 ? ESP_ERR_NOT_FINISHED : ESP_OK;
 }
 
+esp_err_t ms8607_collect(ms8607_reading_t *out)
+{
+    esp_err_t ret = ms8607_poll(NULL);
+    if (ret != ESP_OK) return ret;
+
+    // Either way the devices are idle again once their results are read.
+    ms_state = MS_IDLE;
+    uint32_t raw_d1;
+    uint16_t raw_rh;
+    ESP_RETURN_ON_ERROR(pt_read_adc(&raw_d1), TAG, "Pressure read failed");
+    ESP_RETURN_ON_ERROR(rh_read_raw(&raw_rh), TAG, "RH read failed");
+
+    esp_cpu_cycle_count_t c0 = esp_cpu_get_cycle_count();
+    ms8607_compensate_pt(prom, raw_d1, raw_d2, &out->temperature, &out->pressure);
+    uint32_t cycles = esp_cpu_get_cycle_count() - c0;
+    out->humidity = ms8607_compensate_rh(raw_rh, out->temperature);
+
+    uint32_t pt_us = 2 * pt_conv_us[sample_osr];
+    uint32_t rh_us = rh_conv_us[rh_res_applied];
+    stats.samples++;
+    if (adaptive && sample_osr == MS8607_FAST_OSR) stats.fast_samples++;
+    stats.last_conv_us = pt_us > rh_us ? pt_us : rh_us;
+    stats.last_bus_us = (uint32_t)sample_bus_us;
+    stats.total_conv_us += stats.last_conv_us;
+    stats.total_bus_us += stats.last_bus_us;
+    if (stats.samples == 1) {
+        ESP_LOGI(TAG, "compensation took %lu CPU cycles", (unsigned long)cycles);
+    }
+    stats.compensate_cycles = cycles;
+    if (cycles > stats.compensate_cycles_max) stats.compensate_cycles_max = cycles;
+
+    adapt_resolution(out);
+    last = *out;
+    have_last = true;
+    return ESP_OK;
+}
+
+void ms8607_set_resolution(ms8607_osr_t new_osr, ms8607_rh_res_t new_rh_res)
+{
+    adaptive = false;
+    osr = new_osr;
+    rh_res = new_rh_res;
+}
+
+void ms8607_set_adaptive(bool enable)
+{
+    adaptive = enable;
+    stable_samples = 0;
+    if (enable) {
+        osr = MS8607_PRECISE_OSR;
+        rh_res = MS8607_PRECISE_RH;
+    }
+}
+
+void ms8607_get_stats(ms8607_stats_t *out)
+{
+    *out = stats;
+    out->osr = osr;
+    out->rh_res = rh_res;
+    out->adaptive = adaptive;
+}
+
+esp_err_t ms8607_read_all(ms8607_reading_t *out)
+{
+    ESP_RETURN_ON_ERROR(ms8607_start(), TAG, "Conversion start failed");
+
+    uint32_t remaining_us;
+    esp_err_t ret;
+    while ((ret = ms8607_poll(&remaining_us)) == ESP_ERR_NOT_FINISHED) {
+        // +1 tick: a delay of N ticks can end up to one tick early.
+        vTaskDelay(pdMS_TO_TICKS((remaining_us + 999) / 1000) + 1);
+    }
+    if (ret != ESP_OK) return ret;
+    return ms8607_collect(out);
+}
 
 esp_err_t ms8607_read_temperature_humidity(float *temp_c, float *rh)
 {
-    ESP_RETURN_ON_ERROR(pt_read_temperature(temp_c), TAG, "Temp read failed");
-    ESP_RETURN_ON_ERROR(rh_read(rh), TAG, "RH read failed");
+    ms8607_reading_t r;
+    ESP_RETURN_ON_ERROR(ms8607_read_all(&r), TAG, "Read failed");
+    *temp_c = r.temperature / 100.0f;
+    *rh = r.humidity / 100.0f;
     return ESP_OK;
 }
+
+// ---------------- Sensor scheduler ----------------
+static esp_err_t ms8607_sensor_init(void *ctx)
+{
+    return ms8607_init((i2c_master_bus_handle_t)ctx);
+}
+
+static esp_err_t ms8607_sensor_start(void *ctx)
+{
+    return ms8607_start();
+}
+
+static esp_err_t ms8607_sensor_poll(void *ctx, uint32_t *remaining_us)
+{
+    return ms8607_poll(remaining_us);
+}
+
+static esp_err_t ms8607_sensor_read(void *ctx)
+{
+    ms8607_reading_t r;
+    ESP_RETURN_ON_ERROR(ms8607_collect(&r), TAG, "collect failed");
+    sensor_publish(SENSOR_MS8607_TEMPERATURE, r.temperature);
+    sensor_publish(SENSOR_MS8607_HUMIDITY, r.humidity);
+    sensor_publish(SENSOR_MS8607_PRESSURE, r.pressure);
+    ESP_LOGD(TAG, "%ld cC, %ld c%%RH, %ld Pa", (long)r.temperature, (long)r.humidity, (long)r.pressure);
+    return ESP_OK;
+}
+
+esp_err_t ms8607_sensor_register(i2c_master_bus_handle_t bus)
+{
+    const sensor_driver_t drv = {
+        .name = "ms8607",
+        .init = ms8607_sensor_init,
+        .start = ms8607_sensor_start,
+        .poll = ms8607_sensor_poll,
+        .read = ms8607_sensor_read,
+        .ctx = bus,
+        .period_ms = MS8607_SAMPLE_PERIOD_MS,
+        .deadline_ms = MS8607_DEADLINE_MS,
+    };
+    return sensor_register(&drv);
+}
@@ -1,8 +1,102 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "esp_err.h"
 #include "driver/i2c_master.h"
 
+#define MS8607_SAMPLE_PERIOD_MS 2000
+#define MS8607_DEADLINE_MS      50      /* 18.1 ms worst-case window plus tick rounding */
+
+// PT oversampling ratio; each step doubles the conversion time (0.6 .. 18 ms)
+typedef enum {
+    MS8607_OSR_256,
+    MS8607_OSR_512,
+    MS8607_OSR_1024,
+    MS8607_OSR_2048,
+    MS8607_OSR_4096,
+    MS8607_OSR_8192,
+} ms8607_osr_t;
+
+// RH resolution, in user register order (conversion 16 / 3 / 5 / 9 ms)
+typedef enum {
+    MS8607_RH_12BIT,
+    MS8607_RH_8BIT,
+    MS8607_RH_10BIT,
+    MS8607_RH_11BIT,
+} ms8607_rh_res_t;
+
+// Adaptive policy: full resolution while readings move, fast mode once they
+// have stayed within the noise thresholds for MS8607_STABLE_SAMPLES samples.
+#define MS8607_PRECISE_OSR      MS8607_OSR_4096
+#define MS8607_PRECISE_RH       MS8607_RH_12BIT
+#define MS8607_FAST_OSR         MS8607_OSR_1024
+#define MS8607_FAST_RH          MS8607_RH_10BIT
+#define MS8607_STABLE_SAMPLES   5
+#define MS8607_NOISE_TEMP       10      /* 0.01 C; OSR 1024 noise is ~0.5 */
+#define MS8607_NOISE_PRESSURE   20      /* Pa; OSR 1024 noise is ~4 */
+#define MS8607_NOISE_RH         100     /* 0.01 %RH; 10 bit step is ~12 */
+
+// Fixed-point results, as used by the ZCL measurement clusters.
+typedef struct {
+    int32_t temperature;    // 0.01 C
+    int32_t pressure;       // Pa (= 0.01 mbar)
+    int32_t humidity;       // 0.01 %RH, temperature compensated, 0..10000
+} ms8607_reading_t;
+
+typedef struct {
+    uint32_t samples;
+    uint32_t fast_samples;      // taken in the adaptive fast mode
+    uint32_t mode_switches;
+    uint32_t last_conv_us;      // worst-case conversion window of the last sample
+    uint32_t last_bus_us;       // time spent in I2C transfers for the last sample
+    uint64_t total_conv_us;
+    uint64_t total_bus_us;
+    uint32_t compensate_cycles;     // CPU cycles ms8607_compensate_pt() took for the last sample
+    uint32_t compensate_cycles_max;
+    ms8607_osr_t osr;           // resolution the next sample will use
+    ms8607_rh_res_t rh_res;
+    bool adaptive;
+    // Calibration PROM at init
+    bool prom_cached;           // coefficients came from the NVS cache
+    uint32_t prom_load_us;      // time ms8607_init spent on the PROM
+    uint32_t prom_read_us;      // time a full PROM read takes (saving = read - load)
+    uint32_t crc_failures;      // PROM reads or cache entries that failed crc4
+} ms8607_stats_t;
+
 esp_err_t ms8607_init(i2c_master_bus_handle_t bus);
-esp_err_t ms8607_read_temperature_humidity(float *temp_c, float *rh);
\ No newline at end of file
+
+// Adds the MS8607 to the sensor scheduler; it is initialised there and publishes
+// SENSOR_MS8607_TEMPERATURE, _HUMIDITY and _PRESSURE.
+esp_err_t ms8607_sensor_register(i2c_master_bus_handle_t bus);
+
+// Fixed resolution for the following samples; turns the adaptive policy off.
+// Takes effect at the next ms8607_start().
+void ms8607_set_resolution(ms8607_osr_t osr, ms8607_rh_res_t rh_res);
+// Adaptive resolution (the default): see MS8607_PRECISE_* / MS8607_FAST_*.
+void ms8607_set_adaptive(bool enable);
+void ms8607_get_stats(ms8607_stats_t *out);
+
+// Non-blocking sampling: start the conversions, poll until they are due,
+// then collect. Nothing here sleeps, so it can be driven from a scheduler.
+// ms8607_poll() moves the PT die from temperature to pressure when due and
+// returns ESP_ERR_NOT_FINISHED with the time until it must be polled again
+// (the handover, then the end of the sample), ESP_OK once everything can be
+// collected, or ESP_ERR_INVALID_STATE if nothing was started.
+esp_err_t ms8607_start(void);
+esp_err_t ms8607_poll(uint32_t *remaining_us);
+esp_err_t ms8607_collect(ms8607_reading_t *out);
+
+// Blocking wrappers around start/poll/collect.
+esp_err_t ms8607_read_all(ms8607_reading_t *out);
+esp_err_t ms8607_read_temperature_humidity(float *temp_c, float *rh);
+
+// Datasheet compensation with first- and second-order terms, integer only.
+// c[] is the PROM (C1..C6 at index 1..6), d1/d2 the raw pressure and
+// temperature ADC values.
+void ms8607_compensate_pt(const uint16_t c[8], uint32_t d1, uint32_t d2,
+                          int32_t *temperature, int32_t *pressure);
+int32_t ms8607_compensate_rh(uint16_t raw, int32_t temperature);
+
+// PROM check: the crc4 of words 0..6 against the CRC in bits 15..12 of word 0.
+bool ms8607_prom_valid(const uint16_t *words);
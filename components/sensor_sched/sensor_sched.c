@@ -0,0 +1,177 @@
+#include "sensor_sched.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "boot_trace.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "SENSOR_SCHED";
+
+#define SENSOR_MAX_SLEEP_US     1000000     // upper bound on one wait, keeps the loop alive
+
+typedef struct {
+    sensor_driver_t drv;
+    sensor_stats_t stats;
+    bool converting;
+    int64_t started_us;
+    int64_t next_us;        // start of the next sample slot
+} sensor_slot_t;
+
+typedef struct {
+    int32_t value;
+    int64_t time_us;        // 0 = never published
+} sensor_value_t;
+
+static sensor_slot_t slots[SENSOR_MAX_DRIVERS];
+static int slot_count = 0;
+static bool running = false;
+
+// Written by the scheduler task, read by the Zigbee task
+static sensor_value_t values[SENSOR_VALUE_COUNT];
+static portMUX_TYPE values_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t sensor_register(const sensor_driver_t *driver)
+{
+    if (running || driver->read == NULL || driver->period_ms == 0) return ESP_ERR_INVALID_ARG;
+    if (slot_count >= SENSOR_MAX_DRIVERS) return ESP_ERR_NO_MEM;
+
+    sensor_slot_t *slot = &slots[slot_count++];
+    slot->drv = *driver;
+    slot->stats.name = driver->name;
+    return ESP_OK;
+}
+
+void sensor_publish(sensor_value_id_t id, int32_t value)
+{
+    if (id >= SENSOR_VALUE_COUNT) return;
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&values_lock);
+    values[id].value = value;
+    values[id].time_us = now;
+    portEXIT_CRITICAL(&values_lock);
+}
+
+bool sensor_get(sensor_value_id_t id, int32_t *value, uint32_t *age_ms)
+{
+    if (id >= SENSOR_VALUE_COUNT) return false;
+
+    portENTER_CRITICAL(&values_lock);
+    sensor_value_t v = values[id];
+    portEXIT_CRITICAL(&values_lock);
+
+    if (v.time_us == 0) return false;
+    if (value) *value = v.value;
+    if (age_ms) *age_ms = (uint32_t)((esp_timer_get_time() - v.time_us) / 1000);
+    return true;
+}
+
+bool sensor_get_stats(int index, sensor_stats_t *out)
+{
+    if (index < 0 || index >= slot_count) return false;
+    *out = slots[index].stats;
+    return true;
+}
+
+// A running conversion: collect it once the driver says it is done. Returns when the slot
+// needs attention again.
+static int64_t sensor_service(sensor_slot_t *slot, int64_t now)
+{
+    uint32_t remaining_us = 0;
+    esp_err_t ret = slot->drv.poll ? slot->drv.poll(slot->drv.ctx, &remaining_us) : ESP_OK;
+    if (ret == ESP_ERR_NOT_FINISHED) return now + remaining_us;
+
+    if (ret == ESP_OK) ret = slot->drv.read(slot->drv.ctx);
+    slot->converting = false;
+
+    uint32_t latency_us = (uint32_t)(esp_timer_get_time() - slot->started_us);
+    if (ret != ESP_OK) {
+        slot->stats.errors++;
+        ESP_LOGW(TAG, "%s: %s", slot->drv.name, esp_err_to_name(ret));
+        return slot->next_us;
+    }
+    slot->stats.samples++;
+    if (latency_us > slot->stats.max_latency_us) slot->stats.max_latency_us = latency_us;
+    if (latency_us > slot->drv.deadline_ms * 1000) slot->stats.deadline_misses++;
+    return slot->next_us;
+}
+
+static int64_t sensor_begin(sensor_slot_t *slot, int64_t now)
+{
+    // Next slot on the fixed grid; slots that already passed are skipped, not caught up
+    slot->next_us += (int64_t)slot->drv.period_ms * 1000;
+    if (slot->next_us <= now) {
+        int64_t period_us = (int64_t)slot->drv.period_ms * 1000;
+        int64_t lost = (now - slot->next_us) / period_us + 1;
+        slot->stats.skipped += (uint32_t)lost;
+        slot->next_us += lost * period_us;
+    }
+
+    slot->started_us = now;
+    esp_err_t ret = slot->drv.start ? slot->drv.start(slot->drv.ctx) : ESP_OK;
+    if (ret != ESP_OK) {
+        slot->stats.errors++;
+        ESP_LOGW(TAG, "%s start: %s", slot->drv.name, esp_err_to_name(ret));
+        return slot->next_us;
+    }
+    slot->converting = true;
+    return sensor_service(slot, esp_timer_get_time());
+}
+
+static void sensor_task(void *arg)
+{
+    for (int i = 0; i < slot_count; i++) {
+        sensor_slot_t *slot = &slots[i];
+        esp_err_t ret = slot->drv.init ? slot->drv.init(slot->drv.ctx) : ESP_OK;
+        slot->stats.enabled = ret == ESP_OK;
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "%s init failed: %s, continuing without it", slot->drv.name, esp_err_to_name(ret));
+        }
+    }
+    boot_trace_mark(BOOT_SENSORS_READY);
+
+    // First samples once the sensors have settled, then every period from there
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < slot_count; i++) {
+        slots[i].next_us = now + (int64_t)slots[i].drv.first_sample_ms * 1000;
+    }
+
+    const int64_t tick_us = (int64_t)portTICK_PERIOD_MS * 1000;
+    while (1) {
+        now = esp_timer_get_time();
+        int64_t wake = now + SENSOR_MAX_SLEEP_US;
+
+        for (int i = 0; i < slot_count; i++) {
+            sensor_slot_t *slot = &slots[i];
+            if (!slot->stats.enabled) continue;
+
+            int64_t due;
+            if (slot->converting) {
+                due = sensor_service(slot, now);
+            } else if (now >= slot->next_us) {
+                due = sensor_begin(slot, now);
+            } else {
+                due = slot->next_us;
+            }
+            if (due < wake) wake = due;
+        }
+
+        // Round up to whole ticks; waking a little late is fine, early just polls again
+        int64_t wait_us = wake - esp_timer_get_time();
+        if (wait_us > 0) {
+            vTaskDelay((TickType_t)((wait_us + tick_us - 1) / tick_us));
+        }
+    }
+}
+
+esp_err_t sensor_sched_start(void)
+{
+    if (running) return ESP_ERR_INVALID_STATE;
+    running = true;
+
+    if (xTaskCreate(sensor_task, "sensor_task", SENSOR_TASK_STACK, NULL, 4, NULL) != pdPASS) {
+        running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// One task samples every registered sensor. Drivers never sleep: start() begins a conversion,
+// poll() reports how long it still needs, read() collects it and calls sensor_publish(). Readers
+// such as the Zigbee layer only look at the latest-value table.
+
+#define SENSOR_MAX_DRIVERS      4
+#define SENSOR_TASK_STACK       4096
+
+typedef enum {
+    SENSOR_TC74_TEMPERATURE,        // 0.01 C
+    SENSOR_MS8607_TEMPERATURE,      // 0.01 C
+    SENSOR_MS8607_HUMIDITY,         // 0.01 %RH
+    SENSOR_MS8607_PRESSURE,         // Pa
+    SENSOR_VALUE_COUNT
+} sensor_value_id_t;
+
+typedef struct {
+    const char *name;
+    esp_err_t (*init)(void *ctx);                           // optional, runs once in the scheduler task
+    esp_err_t (*start)(void *ctx);                          // optional, begins a conversion
+    esp_err_t (*poll)(void *ctx, uint32_t *remaining_us);   // optional, ESP_ERR_NOT_FINISHED while converting
+    esp_err_t (*read)(void *ctx);                           // collects the result and publishes it
+    void *ctx;
+    uint32_t period_ms;
+    uint32_t deadline_ms;       // start to published result
+    uint32_t first_sample_ms;   // init to first sample, e.g. a wake-up settle time
+} sensor_driver_t;
+
+typedef struct {
+    const char *name;
+    bool enabled;               // false if init failed
+    uint32_t samples;
+    uint32_t errors;
+    uint32_t deadline_misses;   // results published later than deadline_ms after the start
+    uint32_t skipped;           // sample slots lost because the previous one overran
+    uint32_t max_latency_us;    // start to published result
+} sensor_stats_t;
+
+// Register before sensor_sched_start(); the driver struct is copied.
+esp_err_t sensor_register(const sensor_driver_t *driver);
+
+// Creates the scheduler task, which brings the sensors up first. A sensor whose init fails is
+// left out; the others keep sampling.
+esp_err_t sensor_sched_start(void);
+
+void sensor_publish(sensor_value_id_t id, int32_t value);
+
+// Latest value and its age. False if the value was never published.
+bool sensor_get(sensor_value_id_t id, int32_t *value, uint32_t *age_ms);
+
+// Stats of the index-th registered sensor; false past the last one.
+bool sensor_get_stats(int index, sensor_stats_t *out);
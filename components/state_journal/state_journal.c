@@ -0,0 +1,217 @@
+#include "state_journal.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "STATE_JOURNAL";
+
+#define SECTOR_SIZE       4096
+#define SLOTS_PER_SECTOR  (SECTOR_SIZE / STATE_JOURNAL_RECORD_SIZE)
+#define SEQ_ERASED        0xFFFFFFFFu
+
+typedef struct __attribute__((packed)) {
+    uint32_t seq;        // 1, 2, 3, ... ; all ones in an erased slot
+    uint8_t len;         // payload bytes in use
+    uint8_t reserved[3];
+    uint8_t data[STATE_JOURNAL_PAYLOAD_SIZE];
+    uint32_t crc;        // CRC32 of all bytes above
+} journal_record_t;
+
+_Static_assert(sizeof(journal_record_t) == STATE_JOURNAL_RECORD_SIZE, "journal record size");
+
+static const esp_partition_t *part = NULL;
+static uint32_t num_slots = 0;
+static uint32_t head = 0;          // slot the next record goes to
+static uint32_t latest_slot = 0;   // slot of the newest valid record
+static uint32_t latest_seq = 0;    // 0 while the journal is empty
+static state_journal_stats_t stats;
+
+static uint32_t record_crc(const journal_record_t *rec)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)rec, offsetof(journal_record_t, crc));
+}
+
+static esp_err_t read_slot(uint32_t slot, journal_record_t *rec)
+{
+    stats.mount_reads++;
+    return esp_partition_read(part, slot * STATE_JOURNAL_RECORD_SIZE, rec, sizeof(*rec));
+}
+
+static bool record_is_erased(const journal_record_t *rec)
+{
+    const uint8_t *p = (const uint8_t *)rec;
+    for (size_t i = 0; i < sizeof(*rec); i++) {
+        if (p[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+static bool record_is_valid(const journal_record_t *rec)
+{
+    return rec->seq != SEQ_ERASED && rec->seq != 0 &&
+           rec->len <= STATE_JOURNAL_PAYLOAD_SIZE && rec->crc == record_crc(rec);
+}
+
+// Slots inside a sector are programmed strictly in order, so the used slots form a prefix
+// and the first erased slot can be found by binary search.
+static uint32_t sector_fill(uint32_t sector)
+{
+    uint32_t lo = 0;
+    uint32_t hi = SLOTS_PER_SECTOR;
+    journal_record_t rec;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (read_slot(sector * SLOTS_PER_SECTOR + mid, &rec) != ESP_OK || !record_is_erased(&rec)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Newest valid record among the first `fill` slots of a sector. Only the tail can be torn,
+// so walking back from the end stops after at most a few reads.
+static bool sector_latest(uint32_t sector, uint32_t fill, uint32_t *slot, uint32_t *seq)
+{
+    journal_record_t rec;
+
+    while (fill > 0) {
+        fill--;
+        uint32_t s = sector * SLOTS_PER_SECTOR + fill;
+        if (read_slot(s, &rec) == ESP_OK && record_is_valid(&rec)) {
+            *slot = s;
+            *seq = rec.seq;
+            return true;
+        }
+    }
+    return false;
+}
+
+esp_err_t state_journal_init(void)
+{
+    int64_t start = esp_timer_get_time();
+
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, STATE_JOURNAL_PARTITION);
+    if (part == NULL) {
+        ESP_LOGW(TAG, "No '%s' partition", STATE_JOURNAL_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint32_t sectors = part->size / SECTOR_SIZE;
+    if (sectors < 2) {
+        // With a single sector the erase before a wrap would destroy the only copy
+        ESP_LOGE(TAG, "Partition too small (%lu bytes)", (unsigned long)part->size);
+        part = NULL;
+        return ESP_ERR_INVALID_SIZE;
+    }
+    num_slots = sectors * SLOTS_PER_SECTOR;
+
+    uint32_t newest_sector = 0;
+    uint32_t newest_fill = 0;
+    latest_seq = 0;
+    for (uint32_t sector = 0; sector < sectors; sector++) {
+        uint32_t fill = sector_fill(sector);
+        uint32_t slot, seq;
+        if (sector_latest(sector, fill, &slot, &seq) && seq > latest_seq) {
+            latest_seq = seq;
+            latest_slot = slot;
+            newest_sector = sector;
+            newest_fill = fill;
+        }
+    }
+
+    // Continue after the last programmed slot of the newest sector, skipping a torn tail.
+    // An empty journal starts at slot 0, which erases whatever the partition held before.
+    if (latest_seq == 0) {
+        head = 0;
+    } else {
+        head = (newest_sector * SLOTS_PER_SECTOR + newest_fill) % num_slots;
+    }
+
+    stats.sequence = latest_seq;
+    stats.lifetime_records = (uint64_t)STATE_JOURNAL_ENDURANCE * num_slots;
+    stats.mount_us = (uint32_t)(esp_timer_get_time() - start);
+
+    ESP_LOGI(TAG, "Mounted %lu slots, newest seq %lu at slot %lu, head %lu (%lu reads, %lu us)",
+             (unsigned long)num_slots, (unsigned long)latest_seq, (unsigned long)latest_slot,
+             (unsigned long)head, (unsigned long)stats.mount_reads, (unsigned long)stats.mount_us);
+    return ESP_OK;
+}
+
+bool state_journal_is_mounted(void)
+{
+    return part != NULL;
+}
+
+esp_err_t state_journal_read_latest(void *data, size_t *len)
+{
+    if (part == NULL) return ESP_ERR_INVALID_STATE;
+    if (latest_seq == 0) return ESP_ERR_NOT_FOUND;
+
+    journal_record_t rec;
+    esp_err_t err = esp_partition_read(part, latest_slot * STATE_JOURNAL_RECORD_SIZE, &rec, sizeof(rec));
+    if (err != ESP_OK) return err;
+    if (!record_is_valid(&rec)) return ESP_ERR_INVALID_CRC;
+    if (rec.len > *len) return ESP_ERR_INVALID_SIZE;
+
+    memcpy(data, rec.data, rec.len);
+    *len = rec.len;
+    return ESP_OK;
+}
+
+esp_err_t state_journal_append(const void *data, size_t len)
+{
+    if (part == NULL) return ESP_ERR_INVALID_STATE;
+    if (len > STATE_JOURNAL_PAYLOAD_SIZE) return ESP_ERR_INVALID_SIZE;
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t err;
+
+    if (head % SLOTS_PER_SECTOR == 0) {
+        err = esp_partition_erase_range(part, head * STATE_JOURNAL_RECORD_SIZE, SECTOR_SIZE);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Erase at slot %lu failed: %s", (unsigned long)head, esp_err_to_name(err));
+            return err;
+        }
+        stats.erases++;
+    }
+
+    journal_record_t rec;
+    memset(&rec, 0xFF, sizeof(rec));
+    rec.seq = latest_seq + 1;
+    rec.len = (uint8_t)len;
+    memcpy(rec.data, data, len);
+    rec.crc = record_crc(&rec);
+
+    err = esp_partition_write(part, head * STATE_JOURNAL_RECORD_SIZE, &rec, sizeof(rec));
+    uint32_t slot = head;
+    // The slot is consumed even on failure: it may hold a partial record now
+    head = (head + 1) % num_slots;
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Write at slot %lu failed: %s", (unsigned long)slot, esp_err_to_name(err));
+        // A slot left erased would end the used prefix early and hide every later record from
+        // the mount; all zeros is always programmable and never a valid record
+        memset(&rec, 0, sizeof(rec));
+        esp_partition_write(part, slot * STATE_JOURNAL_RECORD_SIZE, &rec, sizeof(rec));
+        return err;
+    }
+
+    latest_seq = rec.seq;
+    latest_slot = slot;
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+    stats.appends++;
+    stats.sequence = latest_seq;
+    stats.last_write_us = elapsed;
+    if (elapsed > stats.max_write_us) stats.max_write_us = elapsed;
+    return ESP_OK;
+}
+
+void state_journal_get_stats(state_journal_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Append-only journal of small fixed-size state records on a raw data partition.
+// Records are written round-robin; a sector is erased only when the write head enters it,
+// so a save is a single 32-byte program and the erase cost is spread over a whole sector
+// of saves. Each record carries a sequence number and a CRC32, so a write torn by power
+// loss is simply ignored and the previous record wins.
+//
+// Single writer: call append from one task only.
+
+#define STATE_JOURNAL_PARTITION      "journal"
+#define STATE_JOURNAL_RECORD_SIZE    32
+#define STATE_JOURNAL_PAYLOAD_SIZE   20
+#define STATE_JOURNAL_ENDURANCE      100000  // guaranteed erase cycles per flash sector
+
+typedef struct {
+    uint32_t appends;            // records written since boot
+    uint32_t erases;             // sectors erased since boot
+    uint32_t last_write_us;      // latency of the last append, erase included
+    uint32_t max_write_us;       // worst-case append latency
+    uint32_t mount_us;           // time spent finding the newest record at boot
+    uint32_t mount_reads;        // flash reads done while mounting
+    uint32_t sequence;           // sequence number of the newest record, i.e. records ever written
+    uint64_t lifetime_records;   // records the partition can take before reaching the endurance limit
+} state_journal_stats_t;
+
+// Locate the partition and the newest valid record. Returns ESP_ERR_NOT_FOUND if the
+// partition table has no journal partition; the journal is unusable in that case.
+esp_err_t state_journal_init(void);
+
+bool state_journal_is_mounted(void);
+
+// Copy the payload of the newest valid record. On entry *len is the buffer size, on return the
+// stored payload length. ESP_ERR_NOT_FOUND if the journal is empty, ESP_ERR_INVALID_SIZE if the
+// payload does not fit.
+esp_err_t state_journal_read_latest(void *data, size_t *len);
+
+// Append a record of at most STATE_JOURNAL_PAYLOAD_SIZE bytes
+esp_err_t state_journal_append(const void *data, size_t len);
+
+void state_journal_get_stats(state_journal_stats_t *out);
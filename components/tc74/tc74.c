@@ -1,7 +1,8 @@
 #include "tc74.h"
 #include "esp_log.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "esp_check.h"
+#include "boot_trace.h"
+#include "sensor_sched.h"
 
 #define TC74_ADDR 0x4C
 #define REG_TEMP  0x00
@@ -17,24 +18,23 @@ esp_err_t tc74_init(i2c_master_bus_handle_t bus)
         .scl_speed_hz = 100000, // 100 kHz
     };
 
-    ESP_ERROR_CHECK(i2c_master_bus_add_device(bus, &devcfg, &tc74_dev));
+    // Errors are returned rather than aborting: a missing sensor must not stop the lamp
+    ESP_RETURN_ON_ERROR(i2c_master_bus_add_device(bus, &devcfg, &tc74_dev), TAG, "add device failed");
 
     // Read CONFIG register
     uint8_t reg = REG_CONF;
     uint8_t cfg = 0;
 
-    ESP_ERROR_CHECK(
-        i2c_master_transmit_receive(tc74_dev, &reg, 1, &cfg, 1, -1)
-    );
+    ESP_RETURN_ON_ERROR(i2c_master_transmit_receive(tc74_dev, &reg, 1, &cfg, 1, -1), TAG, "CONFIG read failed");
 
     // Wake-up if needed
     if (cfg & 0x80) {
         ESP_LOGW(TAG, "TC74 in standby mode, waking up...");
         uint8_t wake_cmd[2] = { REG_CONF, 0x00 };
-        ESP_ERROR_CHECK(i2c_master_transmit(tc74_dev, wake_cmd, 2, -1));
-        vTaskDelay(pdMS_TO_TICKS(250)); // TC74 requires ≥200ms to wake
+        ESP_RETURN_ON_ERROR(i2c_master_transmit(tc74_dev, wake_cmd, 2, -1), TAG, "wake-up failed");
     }
 
+    boot_trace_mark(BOOT_TC74_READY);
     ESP_LOGI(TAG, "TC74 initialized");
     return ESP_OK;
 }
@@ -64,3 +64,32 @@ esp_err_t tc74_read_temperature(float *out_temp_c)
     return ESP_OK;
 }
 
+// ---------------- Sensor scheduler ----------------
+// The TC74 converts continuously (8 samples/s), so there is nothing to start or wait for.
+static esp_err_t tc74_sensor_init(void *ctx)
+{
+    return tc74_init((i2c_master_bus_handle_t)ctx);
+}
+
+static esp_err_t tc74_sensor_read(void *ctx)
+{
+    float t;
+    ESP_RETURN_ON_ERROR(tc74_read_temperature(&t), TAG, "read failed");
+    sensor_publish(SENSOR_TC74_TEMPERATURE, (int32_t)(t * 100));
+    ESP_LOGD(TAG, "%.0f °C", t);
+    return ESP_OK;
+}
+
+esp_err_t tc74_sensor_register(i2c_master_bus_handle_t bus)
+{
+    const sensor_driver_t drv = {
+        .name = "tc74",
+        .init = tc74_sensor_init,
+        .read = tc74_sensor_read,
+        .ctx = bus,
+        .period_ms = TC74_SAMPLE_PERIOD_MS,
+        .deadline_ms = TC74_DEADLINE_MS,
+        .first_sample_ms = TC74_WAKE_SETTLE_MS,   // in case init woke it from standby
+    };
+    return sensor_register(&drv);
+}
@@ -3,5 +3,15 @@
 #include "esp_err.h"
 #include "driver/i2c_master.h"
 
+#define TC74_SAMPLE_PERIOD_MS   2000
+#define TC74_DEADLINE_MS        20      /* a single register read */
+#define TC74_WAKE_SETTLE_MS     250     /* >= 200 ms from leaving standby to a valid reading */
+
+// Does not wait for a sensor it woke from standby: the first read is valid
+// TC74_WAKE_SETTLE_MS later
 esp_err_t tc74_init(i2c_master_bus_handle_t bus);
 esp_err_t tc74_read_temperature(float *temp_out);
+
+// Adds the TC74 to the sensor scheduler; it is initialised there and publishes
+// SENSOR_TC74_TEMPERATURE.
+esp_err_t tc74_sensor_register(i2c_master_bus_handle_t bus);
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""Generate the integer lookup tables used by the TLC59108 light pipeline:
+the CT mix per mired and the level -> intensity perceptual curves.
+
+Run by the component's CMakeLists.txt at build time; the output header is
+placed in the build directory and included by tlc59108.c.
+"""
+import sys
+
+# Colour temperature range of the LEDs (K) and the mired range exposed over Zigbee
+KELVIN_WARM = 2200
+KELVIN_COOL = 5000
+MIRED_MIN = 200
+MIRED_MAX = 455
+
+Q15_ONE = 1 << 15
+
+# Zigbee CurrentLevel range and the 16-bit internal intensity it maps to
+LEVEL_MAX = 254
+INTENSITY_MAX = 0xFFFF
+
+
+def ct_white_q15(mired):
+    kelvin = 1000000.0 / mired
+    kelvin = min(max(kelvin, KELVIN_WARM), KELVIN_COOL)
+    ratio = (kelvin - KELVIN_WARM) / (KELVIN_COOL - KELVIN_WARM)
+    return int(round(ratio * Q15_ONE))
+
+
+def level_linear(level):
+    return level / LEVEL_MAX
+
+
+def level_cie1931(level):
+    # CIE 1931 lightness: L* in 0..100 -> relative luminance Y
+    lightness = 100.0 * level / LEVEL_MAX
+    if lightness <= 8.0:
+        return lightness / 903.3
+    return ((lightness + 16.0) / 116.0) ** 3
+
+
+def level_gamma22(level):
+    return (level / LEVEL_MAX) ** 2.2
+
+
+def level_table(curve):
+    return [int(round(curve(level) * INTENSITY_MAX)) for level in range(LEVEL_MAX + 1)]
+
+
+def format_table(ctype, name, values, per_line=12):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append("    " + ", ".join(str(v) for v in values[i:i + per_line]) + ",")
+    return "static const %s %s[%d] = {\n%s\n};\n" % (ctype, name, len(values), "\n".join(lines))
+
+
+def main(out_path):
+    ct = [ct_white_q15(m) for m in range(MIRED_MIN, MIRED_MAX + 1)]
+
+    with open(out_path, "w") as f:
+        f.write("// Generated by gen_tables.py - do not edit\n")
+        f.write("#pragma once\n#include <stdint.h>\n\n")
+        f.write("#define CT_MIRED_MIN %d\n" % MIRED_MIN)
+        f.write("#define CT_MIRED_MAX %d\n" % MIRED_MAX)
+        f.write("#define CT_Q15_ONE   %d\n\n" % Q15_ONE)
+        f.write("// White share of the CT mix per mired (Q15, amber = CT_Q15_ONE - white)\n")
+        f.write(format_table("uint16_t", "ct_white_q15", ct))
+        f.write("\n#define LEVEL_MAX     %d\n" % LEVEL_MAX)
+        f.write("#define INTENSITY_MAX %d\n\n" % INTENSITY_MAX)
+        f.write("// Zigbee CurrentLevel -> 16-bit intensity\n")
+        f.write(format_table("uint16_t", "level_linear_u16", level_table(level_linear)))
+        f.write(format_table("uint16_t", "level_cie1931_u16", level_table(level_cie1931)))
+        f.write(format_table("uint16_t", "level_gamma22_u16", level_table(level_gamma22)))
+
+
+if __name__ == "__main__":
+    main(sys.argv[1])
@@ -0,0 +1,154 @@
+#include "led_fade.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+static const char *TAG = "LED_FADE";
+
+// One interpolated quantity in Q8.8 (level or mired), driven by wall-clock time so the frame
+// rate only changes smoothness, never the transition duration
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    int64_t start_us;
+    int64_t duration_us;
+} fade_track_t;
+
+static fade_track_t level_track;
+static fade_track_t mired_track;
+static bool refresh_pending = false;
+static bool fade_running = false;   // as of the last tick, so the end value still gets a frame
+
+// Last target taken from the mailbox, so an unchanged field does not restart its fade
+static led_target_t applied_target;
+static bool target_applied = false;
+
+// The Zigbee task sets targets while the LED task renders frames
+static portMUX_TYPE fade_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t track_value(const fade_track_t *t, int64_t now_us)
+{
+    int64_t elapsed = now_us - t->start_us;
+
+    if (t->duration_us <= 0 || elapsed >= t->duration_us) return t->to;
+    if (elapsed <= 0) return t->from;
+
+    int64_t delta = (int64_t)t->to - (int64_t)t->from;
+    return (uint32_t)((int64_t)t->from + delta * elapsed / t->duration_us);
+}
+
+static bool track_running(const fade_track_t *t, int64_t now_us)
+{
+    return t->duration_us > 0 && now_us - t->start_us < t->duration_us;
+}
+
+static void track_retarget(fade_track_t *t, uint32_t to, uint32_t transition_ms, int64_t now_us)
+{
+    t->from = track_value(t, now_us);
+    t->to = to;
+    t->start_us = now_us;
+    t->duration_us = (int64_t)transition_ms * 1000;
+}
+
+void led_fade_init(uint8_t level, uint16_t mired)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&fade_lock);
+    track_retarget(&level_track, (uint32_t)level << 8, 0, now);
+    track_retarget(&mired_track, (uint32_t)mired << 8, 0, now);
+    level_track.from = level_track.to;
+    mired_track.from = mired_track.to;
+    refresh_pending = true;
+    portEXIT_CRITICAL(&fade_lock);
+}
+
+void led_fade_set_level(uint8_t level, uint32_t transition_ms)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&fade_lock);
+    track_retarget(&level_track, (uint32_t)level << 8, transition_ms, now);
+    refresh_pending = true;
+    portEXIT_CRITICAL(&fade_lock);
+
+    ESP_LOGD(TAG, "Level -> %d over %lu ms", level, (unsigned long)transition_ms);
+}
+
+void led_fade_set_mired(uint16_t mired, uint32_t transition_ms)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&fade_lock);
+    track_retarget(&mired_track, (uint32_t)mired << 8, transition_ms, now);
+    refresh_pending = true;
+    portEXIT_CRITICAL(&fade_lock);
+
+    ESP_LOGD(TAG, "Mired -> %d over %lu ms", mired, (unsigned long)transition_ms);
+}
+
+bool led_fade_tick(void)
+{
+    int64_t now = esp_timer_get_time();
+    bool render;
+    uint32_t level_q8;
+    uint32_t mired_q8;
+
+    portENTER_CRITICAL(&fade_lock);
+    bool running = track_running(&level_track, now) || track_running(&mired_track, now);
+    render = refresh_pending || running || fade_running;
+    fade_running = running;
+    refresh_pending = false;
+    level_q8 = track_value(&level_track, now);
+    mired_q8 = track_value(&mired_track, now);
+    portEXIT_CRITICAL(&fade_lock);
+
+    if (!render) return false;
+
+    // Mired is rounded to whole steps, the CT table has one entry per mired
+    led_apply_level_q8_and_ct((uint16_t)level_q8, (uint16_t)((mired_q8 + 0x80) >> 8));
+    return true;
+}
+
+void led_fade_apply_target(const led_target_t *target)
+{
+    if (!target_applied || target->level != applied_target.level) {
+        led_fade_set_level(target->level, target->transition_ms);
+    }
+    if (!target_applied || target->mired != applied_target.mired) {
+        led_fade_set_mired(target->mired, target->transition_ms);
+    }
+
+    if (target->identify && (!target_applied || !applied_target.identify)) {
+        tlc_identify_start();
+    } else if (!target->identify && target_applied && applied_target.identify) {
+        tlc_identify_stop();
+        led_fade_refresh();
+    }
+
+    applied_target = *target;
+    target_applied = true;
+}
+
+void led_fade_refresh(void)
+{
+    portENTER_CRITICAL(&fade_lock);
+    refresh_pending = true;
+    portEXIT_CRITICAL(&fade_lock);
+}
+
+bool led_fade_is_active(void)
+{
+    int64_t now = esp_timer_get_time();
+    return track_running(&level_track, now) || track_running(&mired_track, now);
+}
+
+uint8_t led_fade_get_level(void)
+{
+    return (uint8_t)(track_value(&level_track, esp_timer_get_time()) >> 8);
+}
+
+uint16_t led_fade_get_mired(void)
+{
+    return (uint16_t)((track_value(&mired_track, esp_timer_get_time()) + 0x80) >> 8);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "tlc59108.h"
+#include "led_mailbox.h"
+
+// Frames are rendered by the LED task on every LED_FADE_DITHER_TICKS-th dither refresh
+#define LED_FADE_FRAME_HZ 100
+#define LED_FADE_FRAME_MS (1000 / LED_FADE_FRAME_HZ)
+#define LED_FADE_DITHER_TICKS (TLC_DITHER_REFRESH_HZ / LED_FADE_FRAME_HZ)
+
+// Jump to a state without fading (boot restore)
+void led_fade_init(uint8_t level, uint16_t mired);
+
+// Start a transition towards a new target. A target set mid-fade starts from the value
+// currently on the LEDs, so back-to-back commands never jump.
+void led_fade_set_level(uint8_t level, uint32_t transition_ms);
+void led_fade_set_mired(uint16_t mired, uint32_t transition_ms);
+
+// Render one frame (a single burst write) if a fade is running or a refresh is pending.
+// Returns true if a frame was rendered.
+bool led_fade_tick(void);
+
+// Render-task side of the mailbox: retarget only the fields that changed since the last
+// target, and start/stop identify blinking
+void led_fade_apply_target(const led_target_t *target);
+
+// Re-render the current state on the next tick, e.g. after an animation overwrote the LEDs
+void led_fade_refresh(void);
+
+bool led_fade_is_active(void);
+uint8_t led_fade_get_level(void);
+uint16_t led_fade_get_mired(void);
@@ -0,0 +1,41 @@
+#include "led_mailbox.h"
+#include <stdatomic.h>
+
+// Triple buffer: the producer owns `back`, the consumer owns `front`, and `middle` is swapped
+// atomically between them. FRESH marks a middle slot the consumer has not taken yet.
+#define SLOT_MASK  0x03
+#define SLOT_FRESH 0x04
+
+static led_target_t slots[3];
+static uint8_t back = 0;                 // producer side
+static uint8_t front = 2;                // consumer side
+static atomic_uint_fast8_t middle = 1;
+static atomic_uint_fast32_t dropped = 0;
+
+void led_mailbox_publish(const led_target_t *target)
+{
+    slots[back] = *target;
+
+    uint_fast8_t prev = atomic_exchange_explicit(&middle, back | SLOT_FRESH, memory_order_acq_rel);
+    if (prev & SLOT_FRESH) {
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+    }
+    back = prev & SLOT_MASK;
+}
+
+bool led_mailbox_take(led_target_t *out)
+{
+    if (!(atomic_load_explicit(&middle, memory_order_acquire) & SLOT_FRESH)) {
+        return false;
+    }
+
+    uint_fast8_t prev = atomic_exchange_explicit(&middle, front, memory_order_acq_rel);
+    front = prev & SLOT_MASK;
+    *out = slots[front];
+    return true;
+}
+
+uint32_t led_mailbox_get_dropped(void)
+{
+    return atomic_load_explicit(&dropped, memory_order_relaxed);
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Desired light state handed from the Zigbee task to the LED render task
+typedef struct {
+    uint8_t level;            // Zigbee CurrentLevel 0..254
+    uint16_t mired;           // colour temperature
+    bool identify;            // identify blinking requested
+    uint32_t transition_ms;   // fade time for the fields that changed
+} led_target_t;
+
+// Lock-free single-producer / single-consumer mailbox that only keeps the newest target.
+// Publishing never blocks; a burst of publishes between two takes collapses to the last one.
+void led_mailbox_publish(const led_target_t *target);
+
+// Returns true and the newest target if one was published since the last take
+bool led_mailbox_take(led_target_t *out);
+
+// Number of published targets that were overwritten before the consumer saw them
+uint32_t led_mailbox_get_dropped(void);
@@ -4,12 +4,47 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <math.h>
+#include <string.h>
+#include "tlc59108_tables.h"
+#include "tlc_dither.h"
+#include "boot_trace.h"
 
 // Breathing animation state
 static bool breathing_enabled = false;
 static float breathing_speed_hz = 0.5f;   // default
 static float breathing_time = 0.0f;
 
+// Hardware effects run on the chip's group PWM / blink engine, software effects are redrawn from led_task
+static tlc_effect_mode_t effect_mode = TLC_EFFECT_HARDWARE;
+static bool hw_effect_active = false;
+static bool hw_breathing = false;   // the running effect is the GRPPWM breathing ramp, not a blink
+
+// Where brightness lives: scaled into PWM0..7 together with the CT mix, or in the GRPPWM master dimmer
+static tlc_dim_mode_t dim_mode = TLC_DEFAULT_DIM_MODE;
+static uint8_t master_level = 0xFF;
+static uint16_t last_level_q8 = 0;
+static uint16_t last_mired = 0;
+
+// Perceptual curve applied to the Zigbee level before it reaches the PWM stages
+static tlc_level_curve_t level_curve = TLC_DEFAULT_LEVEL_CURVE;
+static const uint16_t *level_lut = NULL;
+
+// Sigma-delta dithering: each channel has a 16-bit target whose fraction, quantised to
+// 1/TLC_DITHER_STEPS, is carried in an error accumulator, so successive frames average out to
+// the target without patterns slower than TLC_DITHER_MIN_PATTERN_HZ
+static bool dither_enabled = true;
+static uint16_t channel_target[TLC_NUM_CHANNELS];
+static uint8_t dither_error[TLC_NUM_CHANNELS];
+static bool dither_residue = false;   // some channel target has a fraction to dither, as of the last render
+
+// How a colour group's intensity is shared between its three LEDs
+static tlc_group_alloc_t group_alloc = TLC_DEFAULT_GROUP_ALLOC;
+static uint8_t alloc_rotation = 0;
+
+#define TLC_BREATHE_LEVEL     100   // peak PWM of the breathing effect, matches the software waveform
+#define TLC_TWO_PI            6.28318530718f
+#define TLC_IDENTIFY_PERIOD_MS 500
+
 #define TLC_POWER_GPIO  GPIO_NUM_10
 static bool power_gpio_initialized = false;
 
@@ -22,38 +57,56 @@ uint16_t brightness = 255;  // default full brightness
 #define REG_MODE1   0x00
 #define REG_MODE2   0x01
 #define REG_PWM0    0x02
+#define REG_GRPPWM  0x0A
+#define REG_GRPFREQ 0x0B
 #define REG_LEDOUT0 0x0C
 #define REG_LEDOUT1 0x0D
+#define TLC_NUM_REGS (REG_LEDOUT1 + 1)
+
+#define MODE2_DMBLNK     0x20   // 1 = GRPPWM/GRPFREQ drive group blinking, 0 = group dimming
+#define LEDOUT_ALL_PWM   0xAA   // 10b per LED: individual PWM only
+#define LEDOUT_ALL_GROUP 0xFF   // 11b per LED: individual PWM plus group dimming/blinking
+
+// Control register auto-increment flags (AI2..AI0 in bits 7..5 of the register address byte).
+// 100b increments through every register, so any contiguous dirty range can go out in one write.
+#define TLC_AI_ALL 0x80
+
+// Largest run of clean registers bridged inside one burst. Restarting a transaction costs the
+// address and control bytes, so rewriting a single unchanged register is the cheaper option.
+#define TLC_MAX_CLEAN_GAP 1
 
 static const uint8_t amber_channels[] = {0, 1, 2};
 static const uint8_t white_channels[] = {3, 4, 5};
 static const uint8_t all_channels[]   = {0, 1, 2, 3, 4, 5};
 static i2c_master_dev_handle_t tlc_dev;
 
+// RAM copy of MODE1..LEDOUT1. Setters only touch the shadow and mark registers dirty,
+// tlc59108_flush() then pushes the dirty ranges to the chip.
+static uint8_t shadow[TLC_NUM_REGS];
+static uint16_t dirty_mask = 0;
+static tlc59108_stats_t stats;
+
 static const char *TAG = "TLC9108";
 
-uint8_t tlc_get_amber_brightness(void)
+static uint8_t tlc_group_average(const uint8_t *channels, size_t count)
 {
-    uint8_t sum = 0, v = 0;
+    uint16_t sum = 0;
 
-    for (int i = 0; i < 4; i++) {
-        tlc_read_reg(REG_PWM0 + amber_channels[i], &v);
-        sum += v;
+    for (size_t i = 0; i < count; i++) {
+        sum += shadow[REG_PWM0 + channels[i]];
     }
 
-    return sum / 4;
+    return sum / count;
 }
 
-uint8_t tlc_get_white_brightness(void)
+uint8_t tlc_get_amber_brightness(void)
 {
-    uint8_t sum = 0, v = 0;
-
-    for (int i = 0; i < 4; i++) {
-        tlc_read_reg(REG_PWM0 + white_channels[i], &v);
-        sum += v;
-    }
+    return tlc_group_average(amber_channels, sizeof(amber_channels));
+}
 
-    return sum / 4;
+uint8_t tlc_get_white_brightness(void)
+{
+    return tlc_group_average(white_channels, sizeof(white_channels));
 }
 
 void tlc_reset_init(void)
@@ -179,15 +232,139 @@ void tlc_boot_led_sequence(void)
 
 
 
-static esp_err_t tlc_write_reg(uint8_t reg, uint8_t value)
+static void tlc_shadow_set(uint8_t reg, uint8_t value)
+{
+    if (shadow[reg] == value && !(dirty_mask & (1u << reg))) {
+        stats.writes_suppressed++;
+        return;
+    }
+    shadow[reg] = value;
+    dirty_mask |= 1u << reg;
+}
+
+// 16-bit intensity -> 8-bit register value, rounded
+static uint8_t intensity_to_pwm(uint16_t intensity)
 {
-    uint8_t data[2] = { reg, value };
-    esp_err_t err = i2c_master_transmit(tlc_dev, data, 2, -1);
+    uint32_t pwm = ((uint32_t)intensity + 0x80) >> 8;
+    return pwm > 0xFF ? 0xFF : (uint8_t)pwm;
+}
+
+// Raw register value for a channel: no fractional part, nothing left to dither
+static void tlc_stage_pwm(uint8_t channel, uint8_t value)
+{
+    channel_target[channel] = (uint16_t)value << 8;
+    dither_error[channel] = 0;
+    tlc_shadow_set(REG_PWM0 + channel, value);
+}
+
+// 16-bit target for a channel, rendered into PWMx by tlc_render_targets()
+static void tlc_stage_target(uint8_t channel, uint16_t target)
+{
+    channel_target[channel] = target;
+}
+
+// Stage a colour group at `target` per channel. In spread mode the group total (count x target)
+// is handed out in whole register steps, so a 3-LED group gets 765 steps instead of 255:
+// every channel gets the base value, `extra` channels one step more, and the sub-step remainder
+// goes to the next channel for the dither. `rotation` picks which channels carry the extra steps.
+static void tlc_stage_group(const uint8_t *channels, uint8_t count, uint16_t target, uint8_t rotation)
+{
+    if (group_alloc == TLC_ALLOC_UNIFORM) {
+        for (uint8_t i = 0; i < count; i++) tlc_stage_target(channels[i], target);
+        return;
+    }
+
+    uint32_t total = (uint32_t)target * count;
+    uint32_t steps = total >> 8;
+    uint8_t frac = total & 0xFF;
+    if (steps >= 0xFFu * count) {
+        steps = 0xFFu * count;
+        frac = 0;
+    }
+
+    uint8_t base = steps / count;
+    uint8_t extra = steps % count;
+
+    for (uint8_t i = 0; i < count; i++) {
+        uint16_t value = (uint16_t)base << 8;
+        if (i < extra) {
+            value += 0x100;
+        } else if (i == extra) {
+            value += frac;
+        }
+        tlc_stage_target(channels[(rotation + i) % count], value);
+    }
+}
+
+static void tlc_render_targets(void)
+{
+    bool residue = false;
+
+    for (int ch = 0; ch < TLC_NUM_CHANNELS; ch++) {
+        uint16_t target = channel_target[ch];
+        uint8_t pwm = dither_enabled ? tlc_dither_step(target, &dither_error[ch]) : intensity_to_pwm(target);
+        tlc_shadow_set(REG_PWM0 + ch, pwm);
+        residue |= tlc_dither_has_residue(target);
+    }
+    dither_residue = residue;
+}
+
+static esp_err_t tlc_write_burst(uint8_t first_reg, uint8_t count)
+{
+    uint8_t data[1 + TLC_NUM_REGS];
+    data[0] = TLC_AI_ALL | first_reg;
+    memcpy(&data[1], &shadow[first_reg], count);
+
+    esp_err_t err = i2c_master_transmit(tlc_dev, data, 1 + count, -1);
     if (err != ESP_OK) {
-        printf("TLC write failed: reg=0x%02X val=0x%02X err=%s\n",
-               reg, value, esp_err_to_name(err));
+        printf("TLC write failed: reg=0x%02X len=%d err=%s\n",
+               first_reg, count, esp_err_to_name(err));
+        return err;
     }
-    return err;
+
+    stats.transactions++;
+    stats.bytes += 1 + count;
+    return ESP_OK;
+}
+
+esp_err_t tlc59108_flush(void)
+{
+    uint8_t reg = 0;
+
+    while (dirty_mask != 0 && reg < TLC_NUM_REGS) {
+        if (!(dirty_mask & (1u << reg))) {
+            reg++;
+            continue;
+        }
+
+        // Extend the run over dirty registers, bridging short clean gaps
+        uint8_t first = reg;
+        uint8_t last = reg;
+        for (uint8_t r = reg + 1; r < TLC_NUM_REGS && r - last <= TLC_MAX_CLEAN_GAP + 1; r++) {
+            if (dirty_mask & (1u << r)) last = r;
+        }
+
+        uint8_t count = last - first + 1;
+        ESP_RETURN_ON_ERROR(tlc_write_burst(first, count), TAG, "flush failed");
+
+        for (uint8_t r = first; r <= last; r++) {
+            if (dirty_mask & (1u << r)) stats.writes_issued++;
+        }
+        dirty_mask &= ~(((1u << count) - 1) << first);
+        reg = last + 1;
+    }
+
+    return ESP_OK;
+}
+
+void tlc59108_get_stats(tlc59108_stats_t *out)
+{
+    *out = stats;
+}
+
+void tlc59108_reset_stats(void)
+{
+    memset(&stats, 0, sizeof(stats));
 }
 
 esp_err_t tlc_read_reg(uint8_t reg, uint8_t *out_value)
@@ -195,6 +372,14 @@ esp_err_t tlc_read_reg(uint8_t reg, uint8_t *out_value)
     return i2c_master_transmit_receive(tlc_dev, &reg, 1, out_value, 1, -1);
 }
 
+esp_err_t tlc59108_write_frame(const uint8_t pwm[TLC_NUM_CHANNELS])
+{
+    for (int i = 0; i < TLC_NUM_CHANNELS; i++) {
+        tlc_stage_pwm(i, pwm[i]);
+    }
+    return tlc59108_flush();
+}
+
 esp_err_t tlc59108_init(i2c_master_bus_handle_t bus)
 {
     // Ensure the device is powered before reset
@@ -208,31 +393,45 @@ esp_err_t tlc59108_init(i2c_master_bus_handle_t bus)
     };
     ESP_ERROR_CHECK(i2c_master_bus_add_device(bus, &devcfg, &tlc_dev));
 
+    memset(shadow, 0, sizeof(shadow));
     // MODE1 = normal
-    tlc_write_reg(REG_MODE1, 0x00);
-    // MODE2 = totem-pole, non-inverted
-    tlc_write_reg(REG_MODE2, 0x20);
+    shadow[REG_MODE1] = 0x00;
+    // MODE2 = group blinking selected (only takes effect once LEDOUT enables group control)
+    shadow[REG_MODE2] = MODE2_DMBLNK;
+    // GRPPWM = full scale, harmless while LEDOUT selects plain PWM
+    shadow[REG_GRPPWM] = 0xFF;
     // LEDOUT = PWM mode
-    tlc_write_reg(REG_LEDOUT0, 0xAA);
-    tlc_write_reg(REG_LEDOUT1, 0xAA);
-
-    for (int i = 0; i < 8; i++)
-        tlc_write_reg(REG_PWM0 + i, 0);
+    shadow[REG_LEDOUT0] = LEDOUT_ALL_PWM;
+    shadow[REG_LEDOUT1] = LEDOUT_ALL_PWM;
+
+    if (dim_mode == TLC_DIM_GROUP) {
+        shadow[REG_MODE2] &= ~MODE2_DMBLNK;
+        shadow[REG_LEDOUT0] = LEDOUT_ALL_GROUP;
+        shadow[REG_LEDOUT1] = LEDOUT_ALL_GROUP;
+        shadow[REG_GRPPWM] = master_level;
+    }
 
-    return ESP_OK;
+    // Whole register file goes out in one burst; the chip state is unknown after reset
+    dirty_mask = (1u << TLC_NUM_REGS) - 1;
+    esp_err_t err = tlc59108_flush();
+    boot_trace_mark(BOOT_LED_READY);
+    return err;
 }
 
 esp_err_t tlc59108_set_pwm(uint8_t channel, uint8_t value)
 {
     if (channel > 7) return ESP_ERR_INVALID_ARG;
-    return tlc_write_reg(REG_PWM0 + channel, value);
+    tlc_stage_pwm(channel, value);
+    return tlc59108_flush();
 }
 
 esp_err_t tlc59108_set_group_pwm(const uint8_t *channels, uint8_t count, uint8_t value)
 {
-    for (int i = 0; i < count; i++)
-        tlc59108_set_pwm(channels[i], value);
-    return ESP_OK;
+    for (int i = 0; i < count; i++) {
+        if (channels[i] >= TLC_NUM_CHANNELS) return ESP_ERR_INVALID_ARG;
+        tlc_stage_pwm(channels[i], value);
+    }
+    return tlc59108_flush();
 }
 
 void tlc_dump_registers(void)
@@ -254,23 +453,107 @@ void tlc_dump_registers(void)
 
 esp_err_t tlc_set_all_brightness(uint8_t value)
 {
-    return tlc59108_set_group_pwm(all_channels, 8, value);
+    return tlc59108_set_group_pwm(all_channels, sizeof(all_channels), value);
 }
 
 esp_err_t tlc_set_all_brightness_percentage(uint8_t percentage)
 {
     uint8_t value = percentage_to_8bit(percentage);
-    return tlc59108_set_group_pwm(all_channels, 8, value);
+    return tlc59108_set_group_pwm(all_channels, sizeof(all_channels), value);
 }
 
 esp_err_t tlc_set_white_brightness(uint8_t value)
 {
-    return tlc59108_set_group_pwm(white_channels, 4, value);
+    return tlc59108_set_group_pwm(white_channels, sizeof(white_channels), value);
 }
 
 esp_err_t tlc_set_amber_brightness(uint8_t value)
 {
-    return tlc59108_set_group_pwm(amber_channels, 4, value);
+    return tlc59108_set_group_pwm(amber_channels, sizeof(amber_channels), value);
+}
+
+esp_err_t tlc_hw_blink_start(uint8_t level, uint16_t period_ms, uint8_t duty)
+{
+    // Blink period = (GRPFREQ + 1) / 24 s, so 42 ms .. 10.7 s
+    uint32_t grpfreq = ((uint32_t)period_ms * 24 + 500) / 1000;
+    if (grpfreq > 0) grpfreq--;
+    if (grpfreq > 0xFF) grpfreq = 0xFF;
+
+    for (size_t i = 0; i < sizeof(all_channels); i++) {
+        tlc_stage_pwm(all_channels[i], level);
+    }
+    tlc_shadow_set(REG_GRPPWM, duty);
+    tlc_shadow_set(REG_GRPFREQ, (uint8_t)grpfreq);
+    tlc_shadow_set(REG_MODE2, shadow[REG_MODE2] | MODE2_DMBLNK);
+    tlc_shadow_set(REG_LEDOUT0, LEDOUT_ALL_GROUP);
+    tlc_shadow_set(REG_LEDOUT1, LEDOUT_ALL_GROUP);
+
+    hw_effect_active = true;
+    hw_breathing = false;
+    ESP_LOGI(TAG, "HW blink: level=%d period=%dms duty=%d/256", level, period_ms, duty);
+    return tlc59108_flush();
+}
+
+// Stage MODE2/LEDOUT/GRPPWM for the selected dimming mode (no effect running)
+static void tlc_shadow_dim_mode(void)
+{
+    if (dim_mode == TLC_DIM_GROUP) {
+        tlc_shadow_set(REG_MODE2, shadow[REG_MODE2] & ~MODE2_DMBLNK);
+        tlc_shadow_set(REG_LEDOUT0, LEDOUT_ALL_GROUP);
+        tlc_shadow_set(REG_LEDOUT1, LEDOUT_ALL_GROUP);
+        tlc_shadow_set(REG_GRPPWM, master_level);
+    } else {
+        tlc_shadow_set(REG_LEDOUT0, LEDOUT_ALL_PWM);
+        tlc_shadow_set(REG_LEDOUT1, LEDOUT_ALL_PWM);
+        tlc_shadow_set(REG_GRPPWM, 0xFF);
+    }
+}
+
+esp_err_t tlc_hw_effect_stop(void)
+{
+    if (!hw_effect_active) return ESP_OK;
+
+    tlc_shadow_dim_mode();
+
+    // The effect overwrote PWM0..7; the current level/CT goes back out in the same flush
+    hw_effect_active = false;
+    hw_breathing = false;
+    led_apply_level_q8_and_ct(last_level_q8, last_mired);
+    return ESP_OK;
+}
+
+void tlc_identify_start(void)
+{
+    tlc_hw_blink_start(255, TLC_IDENTIFY_PERIOD_MS, 128);
+}
+
+void tlc_identify_stop(void)
+{
+    tlc_hw_effect_stop();
+}
+
+// breathing waveform: 0...1
+static float tlc_breathe_wave(void)
+{
+    return 0.5f * (1.0f + sinf(TLC_TWO_PI * breathing_speed_hz * breathing_time));
+}
+
+// Hardware breathing: PWM0..5 hold the peak level and the GRPPWM group dimmer carries the
+// waveform, so each step of the ramp is a single-register write instead of a PWM0..5 burst.
+// The blink engine (DMBLNK) would only switch between on and off.
+static void tlc_breathe_start_hw(void)
+{
+    for (size_t i = 0; i < sizeof(all_channels); i++) {
+        tlc_stage_pwm(all_channels[i], TLC_BREATHE_LEVEL);
+    }
+    tlc_shadow_set(REG_GRPPWM, (uint8_t)(tlc_breathe_wave() * 255.0f));
+    tlc_shadow_set(REG_MODE2, shadow[REG_MODE2] & ~MODE2_DMBLNK);
+    tlc_shadow_set(REG_LEDOUT0, LEDOUT_ALL_GROUP);
+    tlc_shadow_set(REG_LEDOUT1, LEDOUT_ALL_GROUP);
+
+    hw_effect_active = true;
+    hw_breathing = true;
+    tlc59108_flush();
 }
 
 void tlc_breathe_update(float dt_seconds)
@@ -278,14 +561,21 @@ void tlc_breathe_update(float dt_seconds)
     if (!breathing_enabled)
         return;
 
-    const float two_pi = 6.28318530718f;
-
-    // breathing waveform: 0...1
-    float wave = 0.5f * (1.0f + sinf(two_pi * breathing_speed_hz * breathing_time));
+    float wave = tlc_breathe_wave();
 
-    uint8_t brightness = (uint8_t)(wave * 100.0f);
+    if (effect_mode == TLC_EFFECT_HARDWARE) {
+        // An Identify blink has the chip; breathing resumes once it ends
+        if (!hw_effect_active) {
+            tlc_breathe_start_hw();
+        } else if (hw_breathing) {
+            tlc_shadow_set(REG_GRPPWM, (uint8_t)(wave * 255.0f));
+            tlc59108_flush();
+        }
+    } else {
+        uint8_t brightness = (uint8_t)(wave * 100.0f);
 
-    tlc_set_all_brightness(brightness);
+        tlc_set_all_brightness(brightness);
+    }
 
     breathing_time += dt_seconds;
 }
@@ -294,60 +584,232 @@ void tlc_breathe_init(float speed_hz)
 {
     breathing_speed_hz = speed_hz;
     breathing_time = 0.0f;
-    breathing_enabled = true;
+    tlc_set_breathing_enabled(true);
 }
 
 void tlc_set_breathing_enabled(bool enabled)
 {
     breathing_enabled = enabled;
+
+    if (effect_mode != TLC_EFFECT_HARDWARE) return;
+
+    if (enabled) {
+        tlc_breathe_start_hw();
+    } else {
+        tlc_hw_effect_stop();
+    }
+}
+
+void tlc_set_effect_mode(tlc_effect_mode_t mode)
+{
+    if (mode == effect_mode) return;
+
+    if (effect_mode == TLC_EFFECT_HARDWARE) {
+        tlc_hw_effect_stop();
+    }
+    effect_mode = mode;
+
+    // Carry a running breathing effect over to the new engine
+    if (breathing_enabled && effect_mode == TLC_EFFECT_HARDWARE) {
+        tlc_breathe_start_hw();
+    }
+}
+
+tlc_effect_mode_t tlc_get_effect_mode(void)
+{
+    return effect_mode;
 }
 
 void tlc_set_channel_brightness(uint8_t channel, uint8_t value)
 {
     if (channel > 7) return;
-    tlc_write_reg(REG_PWM0 + channel, value);
+    tlc59108_set_pwm(channel, value);
     ESP_LOGI(TAG, "Set channel %d to %d", channel, value);
 }
 
-void tlc_set_group_brightness(uint8_t *channels, int count, uint8_t value)
+void tlc_set_group_brightness(const uint8_t *channels, int count, uint8_t value)
 {
-    for(int i = 0; i < count; i++)
-        tlc_set_channel_brightness(channels[i], value);
-    ESP_LOGI(TAG, "Set group %d to %d", channels[0], value);
+    tlc59108_set_group_pwm(channels, count, value);
+    ESP_LOGD(TAG, "Set group %d to %d", channels[0], value);
 }
 
-float ct_white_ratio = 0.5f;
-float ct_amber_ratio = 0.5f;
+// White share of the CT mix for a mired value, Q15. Integer only: the C6 has no FPU.
+static uint16_t ct_white_share(uint16_t mired)
+{
+    if (mired < CT_MIRED_MIN) mired = CT_MIRED_MIN;
+    if (mired > CT_MIRED_MAX) mired = CT_MIRED_MAX;
+    return ct_white_q15[mired - CT_MIRED_MIN];
+}
 
-void led_color_temperature_control(uint16_t brightness, uint16_t mired)
+static const uint16_t *level_curve_table(tlc_level_curve_t curve)
+{
+    switch (curve) {
+    case TLC_CURVE_LINEAR:  return level_linear_u16;
+    case TLC_CURVE_GAMMA22: return level_gamma22_u16;
+    case TLC_CURVE_CIE1931:
+    default:                return level_cie1931_u16;
+    }
+}
+
+void tlc_set_level_curve(tlc_level_curve_t curve)
+{
+    level_curve = curve;
+    level_lut = level_curve_table(curve);
+}
+
+tlc_level_curve_t tlc_get_level_curve(void)
+{
+    return level_curve;
+}
+
+uint16_t tlc_level_to_intensity(uint16_t level)
+{
+    if (level > LEVEL_MAX) level = LEVEL_MAX;
+    if (level_lut == NULL) level_lut = level_curve_table(level_curve);
+    return level_lut[level];
+}
+
+// Fractional level (Q8.8): linear interpolation between neighbouring curve entries, so fades
+// move smoothly through the 16-bit intensity space rather than in whole level steps
+static uint16_t tlc_level_q8_to_intensity(uint16_t level_q8)
 {
-    // Convert mired to Kelvin
-    float kelvin = 1000000.0f / (float)mired;
+    uint16_t level = level_q8 >> 8;
+    uint8_t frac = level_q8 & 0xFF;
+
+    if (level >= LEVEL_MAX || frac == 0) return tlc_level_to_intensity(level);
 
-    // Clamp to valid range given our LED capabilities
-    if (kelvin < 2200.0f) kelvin = 2200.0f;
-    if (kelvin > 5000.0f) kelvin = 5000.0f;
+    uint16_t lo = tlc_level_to_intensity(level);
+    uint16_t hi = tlc_level_to_intensity(level + 1);
+    return lo + (uint16_t)(((uint32_t)(hi - lo) * frac) >> 8);
+}
 
-    ct_white_ratio = (kelvin - 2200.0f) / (5000.0f - 2200.0f);
-    if (ct_white_ratio < 0) ct_white_ratio = 0;
-    if (ct_white_ratio > 1) ct_white_ratio = 1;
+static uint16_t scale_q15(uint16_t intensity, uint16_t share_q15)
+{
+    return (uint16_t)(((uint32_t)intensity * share_q15) >> 15);
+}
 
-    ct_amber_ratio = 1.0f - ct_white_ratio;
 
-    // Apply combined brightness + CT
+void led_color_temperature_control(uint16_t brightness, uint16_t mired)
+{
+    // The CT mix is looked up from mired on every apply, so there is no ratio state to update
     led_apply_brightness_and_ct(brightness, mired);
 }
 
 void led_apply_brightness_and_ct(uint16_t brightness, uint16_t mired)
 {
-    uint8_t amber_pwm = (uint16_t)(brightness * ct_amber_ratio);
-    uint8_t white_pwm = (uint16_t)(brightness * ct_white_ratio);
+    led_apply_level_q8_and_ct((uint16_t)(brightness > LEVEL_MAX ? LEVEL_MAX : brightness) << 8, mired);
+}
+
+void led_apply_level_q8_and_ct(uint16_t level_q8, uint16_t mired)
+{
+    uint16_t white_share = ct_white_share(mired);
+    uint16_t amber_share = CT_Q15_ONE - white_share;
+    uint16_t intensity = tlc_level_q8_to_intensity(level_q8);
+    uint16_t amber_target;
+    uint16_t white_target;
+    bool changed = level_q8 != last_level_q8 || mired != last_mired;
+
+    last_level_q8 = level_q8;
+    last_mired = mired;
+
+    if (dim_mode == TLC_DIM_GROUP) {
+        // PWM0..7 carry the CT mix at full scale; the shadow drops them unless the mix changed,
+        // so a pure level step only rewrites GRPPWM
+        amber_target = scale_q15(INTENSITY_MAX, amber_share);
+        white_target = scale_q15(INTENSITY_MAX, white_share);
+        master_level = intensity_to_pwm(intensity);
+        // The lowest curve entries round to 0 and would turn a lit lamp off
+        if (master_level == 0 && level_q8 != 0) master_level = 1;
+    } else {
+        amber_target = scale_q15(intensity, amber_share);
+        white_target = scale_q15(intensity, white_share);
+    }
 
-    tlc_set_group_brightness(amber_channels, 3, amber_pwm);
-    tlc_set_group_brightness(white_channels, 3, white_pwm);
+    // A running blink/Identify owns PWM0..7 and GRPPWM; tlc_hw_effect_stop() pushes the frame
+    if (hw_effect_active) return;
+    if (dim_mode == TLC_DIM_GROUP) {
+        tlc_shadow_set(REG_GRPPWM, master_level);
+    }
 
-    ESP_LOGI(TAG, "Final output: amber=%d white=%d", amber_pwm, white_pwm);
-    ESP_LOGI(TAG, "Current brightness =%d", brightness);
+    // Both colour groups land in the same flush so amber and white switch together
+    // Rotate the channels carrying the extra steps on every new frame to even out LED heating.
+    // A repeated value keeps the rotation, so it renders identically and the shadow drops it.
+    if (changed) alloc_rotation = (alloc_rotation + 1) % sizeof(amber_channels);
+    tlc_stage_group(amber_channels, sizeof(amber_channels), amber_target, alloc_rotation);
+    tlc_stage_group(white_channels, sizeof(white_channels), white_target, alloc_rotation);
+    tlc_render_targets();
+    tlc59108_flush();
+
+    ESP_LOGD(TAG, "Final output: amber=0x%04X white=0x%04X (level=%d.%02X)", amber_target, white_target, level_q8 >> 8, level_q8 & 0xFF);
+}
+
+esp_err_t tlc_dither_tick(void)
+{
+    // A running blink/pulse effect owns the PWM registers, and whole-step targets render to
+    // the frame that is already on the chip
+    if (!tlc_dither_active()) return ESP_OK;
+
+    // Channels without a fractional part render to the same value and are dropped by the shadow,
+    // so a frame costs at most one burst over PWM0..PWM7
+    tlc_render_targets();
+    return tlc59108_flush();
+}
+
+bool tlc_dither_active(void)
+{
+    return dither_enabled && dither_residue && !hw_effect_active;
+}
+
+void tlc_set_group_alloc(tlc_group_alloc_t alloc)
+{
+    if (alloc == group_alloc) return;
+    group_alloc = alloc;
+    led_apply_level_q8_and_ct(last_level_q8, last_mired);
+}
+
+tlc_group_alloc_t tlc_get_group_alloc(void)
+{
+    return group_alloc;
+}
+
+void tlc_set_dither_enabled(bool enabled)
+{
+    dither_enabled = enabled;
+    memset(dither_error, 0, sizeof(dither_error));
+}
+
+void tlc_set_dimming_mode(tlc_dim_mode_t mode)
+{
+    if (mode == dim_mode) return;
+    dim_mode = mode;
+
+    if (!hw_effect_active) {
+        tlc_shadow_dim_mode();
+    }
+    led_apply_level_q8_and_ct(last_level_q8, last_mired);
+}
+
+tlc_dim_mode_t tlc_get_dimming_mode(void)
+{
+    return dim_mode;
+}
+
+uint16_t tlc_get_effective_duty(uint8_t channel)
+{
+    if (channel >= TLC_NUM_CHANNELS) return 0;
+
+    // Output model: the chip's duty is PWMx/256, and with group control enabled the ~190 Hz
+    // GRPPWM stage gates it again by GRPPWM/256. Level steps stay 1/256 in both modes, and in
+    // group mode the CT mix keeps its full 8 bits instead of being truncated at low levels.
+    uint16_t duty = (uint16_t)shadow[REG_PWM0 + channel] << 8;
+    uint8_t ledout = (shadow[REG_LEDOUT0 + channel / 4] >> ((channel % 4) * 2)) & 0x3;
+
+    if (ledout == 0x0) return 0;
+    if (ledout == 0x1) return 0xFFFF;
+    if (ledout == 0x3 && !(shadow[REG_MODE2] & MODE2_DMBLNK)) {
+        duty = (uint16_t)(((uint32_t)shadow[REG_PWM0 + channel] * shadow[REG_GRPPWM]));
+    }
+    return duty;
 }
 
 
@@ -373,6 +835,8 @@ void led_boot_trail_spin_animation(void)
     const int spin_delay_ms = 120;     // speed of rotation
     const int rotations = 2;           // number of full spins
 
+    uint8_t frame[TLC_NUM_CHANNELS] = {0};
+
     // Spin with trailing fade
     for (int r = 0; r < rotations; r++) {
         for (int head = 0; head < num_leds; head++) {
@@ -382,8 +846,9 @@ void led_boot_trail_spin_animation(void)
                 int value = head_brightness - dist * trail_step;
                 if (value < 0) value = 0;
 
-                tlc_set_channel_brightness(all_channels[i], (uint8_t)value);
+                frame[all_channels[i]] = (uint8_t)value;
             }
+            tlc59108_write_frame(frame);
 
             vTaskDelay(pdMS_TO_TICKS(spin_delay_ms));
         }
@@ -393,25 +858,19 @@ void led_boot_trail_spin_animation(void)
     // Fade up
     // -------------------------
     for (int b = 0; b <= 255; b += 5) {
-        for (int i = 0; i < num_leds; i++) {
-            tlc_set_channel_brightness(all_channels[i], b);
-        }
+        tlc_set_all_brightness((uint8_t)b);
         vTaskDelay(pdMS_TO_TICKS(15));
     }
 
 
     // Fade down
     for (int b = 255; b >= 0; b -= 5) {
-        for (int i = 0; i < num_leds; i++) {
-            tlc_set_channel_brightness(all_channels[i], (uint8_t)b);
-        }
+        tlc_set_all_brightness((uint8_t)b);
         vTaskDelay(pdMS_TO_TICKS(15));
     }
 
     // Ensure all LEDs are off at the end
-    for (int i = 0; i < num_leds; i++) {
-        tlc_set_channel_brightness(all_channels[i], 0);
-    }
+    tlc_set_all_brightness(0);
 }
 
 void zigbee_connection_confirmed_sequence(void)
@@ -3,13 +3,95 @@
 #include "esp_err.h"
 #include "driver/i2c_master.h"
 
+#define TLC_NUM_CHANNELS 8
+
+// Bus accounting for the shadow register cache
+typedef struct {
+    uint32_t writes_suppressed;   // register writes dropped because the value was unchanged
+    uint32_t writes_issued;       // dirty registers actually sent to the chip
+    uint32_t transactions;        // I2C write transactions
+    uint32_t bytes;               // payload bytes including the control byte
+} tlc59108_stats_t;
+
+typedef enum {
+    TLC_EFFECT_SOFTWARE,   // effects redrawn over I2C by tlc_breathe_update()
+    TLC_EFFECT_HARDWARE,   // breathing ramps the GRPPWM group dimmer, Identify runs on the blink engine
+} tlc_effect_mode_t;
+
+typedef enum {
+    TLC_DIM_PWM,     // brightness scaled into PWM0..7 together with the CT mix
+    TLC_DIM_GROUP,   // CT mix in PWM0..7, brightness in the GRPPWM master dimmer (one register per step)
+} tlc_dim_mode_t;
+
+// Perceptual mapping from Zigbee CurrentLevel (0..254) to 16-bit intensity
+typedef enum {
+    TLC_CURVE_LINEAR,    // level proportional to duty (previous behaviour)
+    TLC_CURVE_CIE1931,   // CIE 1931 lightness L*
+    TLC_CURVE_GAMMA22,   // duty = level^2.2
+} tlc_level_curve_t;
+
+#ifndef TLC_DEFAULT_LEVEL_CURVE
+#define TLC_DEFAULT_LEVEL_CURVE TLC_CURVE_CIE1931
+#endif
+
+typedef enum {
+    TLC_ALLOC_UNIFORM,   // all LEDs of a colour group get the same value (256 steps per group)
+    TLC_ALLOC_SPREAD,    // group total spread across its LEDs, e.g. 100,100,101 (766 steps per group)
+} tlc_group_alloc_t;
+
+#ifndef TLC_DEFAULT_GROUP_ALLOC
+#define TLC_DEFAULT_GROUP_ALLOC TLC_ALLOC_SPREAD
+#endif
+
+// Refresh rate of the sigma-delta dither; tlc_dither_tick() has to be called at this rate, from
+// a timer rather than the 100 Hz FreeRTOS tick
+#ifndef TLC_DITHER_REFRESH_HZ
+#define TLC_DITHER_REFRESH_HZ 400
+#endif
+#define TLC_DITHER_PERIOD_US (1000000 / TLC_DITHER_REFRESH_HZ)
+
+// Slowest repeat rate allowed for a dither pattern. A one-step pattern below about 100 Hz
+// flickers visibly at low levels, so fractions are quantised to what the refresh rate can
+// render above it: quarter steps at 400 Hz, nothing (plain rounding) at 100 Hz.
+#ifndef TLC_DITHER_MIN_PATTERN_HZ
+#define TLC_DITHER_MIN_PATTERN_HZ 100
+#endif
+
+#ifndef TLC_DEFAULT_DIM_MODE
+#define TLC_DEFAULT_DIM_MODE TLC_DIM_PWM
+#endif
+
 void led_color_temperature_control(uint16_t brightness, uint16_t mired);
 void led_apply_brightness_and_ct(uint16_t brightness, uint16_t mired);
+// Same as led_apply_brightness_and_ct() with a fractional level in Q8.8, used by the fade engine
+void led_apply_level_q8_and_ct(uint16_t level_q8, uint16_t mired);
+void tlc_set_dimming_mode(tlc_dim_mode_t mode);
+tlc_dim_mode_t tlc_get_dimming_mode(void);
+void tlc_set_level_curve(tlc_level_curve_t curve);
+tlc_level_curve_t tlc_get_level_curve(void);
+// Single table lookup: CurrentLevel -> 0..65535 intensity on the selected curve
+uint16_t tlc_level_to_intensity(uint16_t level);
+// Render the next dithered frame of the 16-bit channel targets (one burst at most)
+esp_err_t tlc_dither_tick(void);
+// True while some channel sits between two register steps, i.e. tlc_dither_tick() has work;
+// the refresh timer only needs to run then
+bool tlc_dither_active(void);
+void tlc_set_dither_enabled(bool enabled);
+void tlc_set_group_alloc(tlc_group_alloc_t alloc);
+tlc_group_alloc_t tlc_get_group_alloc(void);
+// Effective duty of a channel as the chip sees it, 0..65535 (PWM stage times GRPPWM stage)
+uint16_t tlc_get_effective_duty(uint8_t channel);
 //extern uint8_t brightness;
 
 esp_err_t tlc59108_init(i2c_master_bus_handle_t bus);
 esp_err_t tlc59108_set_pwm(uint8_t channel, uint8_t value);
 esp_err_t tlc59108_set_group_pwm(const uint8_t *channels, uint8_t count, uint8_t value);
+// Update PWM0..PWM7 in the shadow and flush the changed ones in a single auto-increment write
+esp_err_t tlc59108_write_frame(const uint8_t pwm[TLC_NUM_CHANNELS]);
+// Push all dirty shadow registers, one auto-increment write per contiguous range
+esp_err_t tlc59108_flush(void);
+void tlc59108_get_stats(tlc59108_stats_t *out);
+void tlc59108_reset_stats(void);
 esp_err_t tlc_read_reg(uint8_t reg, uint8_t *out_value);
 
 esp_err_t tlc_set_all_brightness(uint8_t value);
@@ -34,9 +116,17 @@ void tlc_boot_led_sequence(void);
 void tlc_breathe_init(float speed_hz);
 void tlc_breathe_update(float dt_seconds);
 void tlc_set_breathing_enabled(bool enabled);
+void tlc_set_effect_mode(tlc_effect_mode_t mode);
+tlc_effect_mode_t tlc_get_effect_mode(void);
+
+// Hardware blink engine: all channels at `level`, on for duty/256 of each period
+esp_err_t tlc_hw_blink_start(uint8_t level, uint16_t period_ms, uint8_t duty);
+esp_err_t tlc_hw_effect_stop(void);
+void tlc_identify_start(void);
+void tlc_identify_stop(void);
 
 void tlc_set_channel_brightness(uint8_t channel, uint8_t value);
-void tlc_set_group_brightness(uint8_t *channels, int count, uint8_t value);
+void tlc_set_group_brightness(const uint8_t *channels, int count, uint8_t value);
 
 uint8_t percentage_to_8bit(uint8_t percentage);
 uint8_t tlc_get_white_brightness(void);
@@ -0,0 +1,38 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "tlc59108.h"
+
+// Sub-step resolution of the dither: the fraction is kept in 1/TLC_DITHER_STEPS of a register
+// step, so every pattern repeats within TLC_DITHER_STEPS frames and never runs slower than
+// TLC_DITHER_MIN_PATTERN_HZ. Below 2 there is nothing left to dither and frames are rounded.
+#define TLC_DITHER_STEPS (TLC_DITHER_REFRESH_HZ / TLC_DITHER_MIN_PATTERN_HZ)
+
+// One frame of a channel: 8-bit register value for a 16-bit target, carrying the quantised
+// fraction in *error (0 .. TLC_DITHER_STEPS - 1) from frame to frame
+static inline uint8_t tlc_dither_step(uint16_t target, uint8_t *error)
+{
+    uint32_t pwm = target >> 8;
+    uint32_t frac = ((uint32_t)(target & 0xFF) * TLC_DITHER_STEPS + 0x80) >> 8;
+
+    if (TLC_DITHER_STEPS < 2 || frac == TLC_DITHER_STEPS) {
+        pwm += frac != 0;
+        *error = 0;
+    } else {
+        uint32_t acc = *error + frac;
+        if (acc >= TLC_DITHER_STEPS) {
+            pwm++;
+            acc -= TLC_DITHER_STEPS;
+        }
+        *error = (uint8_t)acc;
+    }
+    return pwm > 0xFF ? 0xFF : (uint8_t)pwm;
+}
+
+// True if the target's fraction makes the channel alternate between two register values;
+// without one, every frame renders the same value
+static inline bool tlc_dither_has_residue(uint16_t target)
+{
+    uint32_t frac = ((uint32_t)(target & 0xFF) * TLC_DITHER_STEPS + 0x80) >> 8;
+    return TLC_DITHER_STEPS >= 2 && frac != 0 && frac != TLC_DITHER_STEPS && (target >> 8) < 0xFF;
+}
@@ -0,0 +1,114 @@
+#include "light_store.h"
+#include "zigbee_app.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+
+static const char *TAG = "LIGHT_STORE";
+
+static TaskHandle_t store_task = NULL;
+static volatile bool dirty = false;
+static light_store_stats_t stats;
+
+// State written by the last flush, to skip commits that would not change anything
+static light_state_t saved;
+static bool saved_valid = false;
+
+static bool light_state_equal(const light_state_t *a, const light_state_t *b)
+{
+    return a->level == b->level && a->mired == b->mired && a->on == b->on &&
+           a->startup.on_off == b->startup.on_off && a->startup.level == b->startup.level &&
+           a->startup.mired == b->startup.mired;
+}
+
+static void light_store_flush(void)
+{
+    dirty = false;
+
+    // One consistent copy: the Zigbee task may be halfway through the next change
+    light_state_t state;
+    light_state_snapshot(&state);
+    if (saved_valid && light_state_equal(&state, &saved)) {
+        stats.skipped++;
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    SaveToNVS(&state);
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+
+    saved = state;
+    saved_valid = true;
+    stats.flushes++;
+    stats.last_flush_us = elapsed;
+    if (elapsed > stats.max_flush_us) stats.max_flush_us = elapsed;
+
+    ESP_LOGI(TAG, "Flushed in %lu us (flushes=%lu updates=%lu coalesced=%lu)",
+             (unsigned long)elapsed, (unsigned long)stats.flushes,
+             (unsigned long)stats.updates, (unsigned long)stats.coalesced);
+}
+
+static void light_store_task(void *arg)
+{
+    const TickType_t quiet = pdMS_TO_TICKS(LIGHT_STORE_QUIET_MS);
+    const TickType_t max_interval = pdMS_TO_TICKS(LIGHT_STORE_MAX_INTERVAL_MS);
+
+    while (1) {
+        // Sleep until the first unsaved change
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        TickType_t first = xTaskGetTickCount();
+
+        // Keep waiting while changes keep coming, bounded by the max interval
+        while (1) {
+            TickType_t elapsed = xTaskGetTickCount() - first;
+            if (elapsed >= max_interval) break;
+
+            TickType_t wait = max_interval - elapsed;
+            if (wait > quiet) wait = quiet;
+            if (ulTaskNotifyTake(pdTRUE, wait) == 0) break;
+        }
+
+        light_store_flush();
+    }
+}
+
+esp_err_t light_store_start(bool persisted)
+{
+    if (store_task != NULL) return ESP_OK;
+
+    // Whatever was just loaded is what is in flash, unless loading already changed it (StartUp*
+    // behaviour); with nothing stored the first flush must write
+    if (persisted && !dirty) {
+        light_state_snapshot(&saved);
+        saved_valid = true;
+    }
+
+    if (xTaskCreate(light_store_task, "light_store", 3072, NULL, 3, &store_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start flush task");
+        return ESP_ERR_NO_MEM;
+    }
+    if (dirty) {
+        xTaskNotifyGive(store_task);
+    }
+    return ESP_OK;
+}
+
+void light_store_mark_dirty(void)
+{
+    stats.updates++;
+    if (dirty) {
+        stats.coalesced++;
+    }
+    dirty = true;
+
+    if (store_task != NULL) {
+        xTaskNotifyGive(store_task);
+    }
+}
+
+void light_store_get_stats(light_store_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// Write-behind persistence of the light state. Changes only mark the state dirty; a background
+// task commits once the state has been quiet for LIGHT_STORE_QUIET_MS, or at the latest
+// LIGHT_STORE_MAX_INTERVAL_MS after the first unsaved change.
+#define LIGHT_STORE_QUIET_MS        2000
+#define LIGHT_STORE_MAX_INTERVAL_MS 10000
+
+typedef struct {
+    uint32_t updates;        // light_store_mark_dirty() calls
+    uint32_t coalesced;      // updates merged into an already pending flush
+    uint32_t flushes;        // journal appends / NVS commits performed
+    uint32_t skipped;        // flushes dropped because the state matched the last save
+    uint32_t max_flush_us;   // worst-case flush latency
+    uint32_t last_flush_us;
+} light_store_stats_t;
+
+// persisted: the current state was just loaded from flash, so it need not be written again.
+// Changes marked before the start (StartUp* behaviour at load) are flushed once it runs.
+esp_err_t light_store_start(bool persisted);
+
+// Cheap enough for the Zigbee callback: bumps counters and notifies the flush task
+void light_store_mark_dirty(void);
+
+void light_store_get_stats(light_store_stats_t *out);
@@ -0,0 +1,250 @@
+#include "zb_rejoin.h"
+#include "zigbee_app.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_rom_crc.h"
+#include "nvs.h"
+#include <string.h>
+#include <stddef.h>
+
+static const char *TAG = "ZB_REJOIN";
+
+#define ZB_NET_NAMESPACE "storage"
+#define ZB_NET_KEY       "zb_net"
+#define ZB_NET_VERSION   1
+
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t channel;
+    uint8_t reserved[2];
+    esp_zb_ieee_addr_t ext_pan_id;
+    uint32_t crc;          // CRC32 of all bytes above
+} zb_net_blob_t;
+
+static zb_net_blob_t net;             // channel 0 = nothing persisted
+static zb_rejoin_stats_t stats;
+
+// Current cycle; everything runs in the Zigbee task (signal handler and scheduler alarms)
+static bool cycle_active = false;
+static bool cycle_commissioned = false;
+static uint32_t cycle_attempts = 0;
+static int64_t cycle_start_us = 0;
+static zb_rejoin_stage_t cycle_stage = ZB_REJOIN_STAGE_STORED;
+static uint8_t parent_unavailable = 0;
+static int64_t parent_unavailable_us = 0;
+
+static uint32_t zb_net_crc(const zb_net_blob_t *blob)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)blob, offsetof(zb_net_blob_t, crc));
+}
+
+static void zb_net_save(void)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(ZB_NET_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "nvs_open failed: %s", esp_err_to_name(err));
+        return;
+    }
+
+    if (net.channel == 0) {
+        err = nvs_erase_key(handle, ZB_NET_KEY);
+        if (err == ESP_ERR_NVS_NOT_FOUND) err = ESP_OK;
+    } else {
+        net.version = ZB_NET_VERSION;
+        net.crc = zb_net_crc(&net);
+        err = nvs_set_blob(handle, ZB_NET_KEY, &net, sizeof(net));
+    }
+    if (err == ESP_OK) err = nvs_commit(handle);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Saving network failed: %s", esp_err_to_name(err));
+    }
+    nvs_close(handle);
+}
+
+void zb_rejoin_init(void)
+{
+    nvs_handle_t handle;
+    memset(&net, 0, sizeof(net));
+
+    if (nvs_open(ZB_NET_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) return;
+    size_t size = sizeof(net);
+    esp_err_t err = nvs_get_blob(handle, ZB_NET_KEY, &net, &size);
+    nvs_close(handle);
+
+    if (err != ESP_OK || size != sizeof(net) || net.version != ZB_NET_VERSION || net.crc != zb_net_crc(&net) ||
+        net.channel < 11 || net.channel > 26) {
+        memset(&net, 0, sizeof(net));
+        return;
+    }
+    stats.channel = net.channel;
+    ESP_LOGI(TAG, "Last network on channel %d", net.channel);
+}
+
+bool zb_rejoin_has_network(void)
+{
+    return net.channel != 0;
+}
+
+void zb_rejoin_configure(void)
+{
+    // The stack's own start-up rejoin uses its stored network info; steering sets its own masks
+    uint32_t primary = ZB_REJOIN_PREFERRED_CHANNELS;
+    if (net.channel != 0) primary |= 1UL << net.channel;
+    esp_zb_set_primary_network_channel_set(primary);
+    esp_zb_set_secondary_network_channel_set(ESP_ZB_TRANSCEIVER_ALL_CHANNELS_MASK);
+}
+
+// Stage for the n-th attempt (0-based) of a cycle; stages with nothing persisted behind them
+// are skipped, and the last one repeats
+static zb_rejoin_stage_t stage_for_attempt(uint32_t n)
+{
+    zb_rejoin_stage_t stages[ZB_REJOIN_STAGE_COUNT];
+    uint32_t count = 0;
+
+    if (cycle_commissioned) stages[count++] = ZB_REJOIN_STAGE_STORED;
+    if (net.channel != 0) stages[count++] = ZB_REJOIN_STAGE_LAST_CHANNEL;
+    stages[count++] = ZB_REJOIN_STAGE_PREFERRED;
+    stages[count++] = ZB_REJOIN_STAGE_ALL;
+
+    uint32_t index = n / ZB_REJOIN_ATTEMPTS_PER_STAGE;
+    return stages[index < count ? index : count - 1];
+}
+
+static void zb_rejoin_attempt(uint8_t param)
+{
+    (void)param;
+
+    cycle_stage = stage_for_attempt(cycle_attempts);
+    cycle_attempts++;
+    stats.attempts++;
+
+    if (cycle_stage == ZB_REJOIN_STAGE_STORED) {
+        ESP_LOGI(TAG, "Attempt %lu: rejoin from stored network", (unsigned long)cycle_attempts);
+        esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_INITIALIZATION);
+        return;
+    }
+
+    // Steering scans the primary set and then the secondary set; both get the stage's mask so
+    // the scan does not widen behind the policy's back
+    esp_zb_ieee_addr_t ext_pan_id = {0};   // all zeros: any PAN
+    uint32_t mask;
+    switch (cycle_stage) {
+    case ZB_REJOIN_STAGE_LAST_CHANNEL:
+        mask = 1UL << net.channel;
+        memcpy(ext_pan_id, net.ext_pan_id, sizeof(ext_pan_id));
+        break;
+    case ZB_REJOIN_STAGE_PREFERRED:
+        mask = ZB_REJOIN_PREFERRED_CHANNELS;
+        if (net.channel != 0) mask |= 1UL << net.channel;
+        break;
+    default:
+        mask = ESP_ZB_TRANSCEIVER_ALL_CHANNELS_MASK;
+        break;
+    }
+    esp_zb_set_extended_pan_id(ext_pan_id);
+    esp_zb_set_primary_network_channel_set(mask);
+    esp_zb_set_secondary_network_channel_set(mask);
+
+    ESP_LOGI(TAG, "Attempt %lu: steering, stage %d, channels 0x%08lx", (unsigned long)cycle_attempts, cycle_stage,
+             (unsigned long)mask);
+    esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_STEERING);
+}
+
+void zb_rejoin_begin(bool commissioned)
+{
+    cycle_active = true;
+    cycle_commissioned = commissioned;
+    cycle_attempts = 0;
+    cycle_start_us = esp_timer_get_time();
+    parent_unavailable = 0;
+    zb_rejoin_attempt(0);
+}
+
+void zb_rejoin_link_lost(void)
+{
+    if (cycle_active) return;
+    ESP_LOGW(TAG, "Lost the link to the network, rejoining");
+    zb_rejoin_begin(true);
+}
+
+void zb_rejoin_device_unavailable(uint16_t short_addr)
+{
+    esp_zb_nwk_info_iterator_t it = ESP_ZB_NWK_INFO_ITERATOR_INIT;
+    esp_zb_nwk_neighbor_info_t neighbor;
+
+    while (esp_zb_nwk_get_next_neighbor(&it, &neighbor) == ESP_OK) {
+        if (neighbor.relationship != ESP_ZB_NWK_RELATIONSHIP_PARENT) continue;
+        if (neighbor.short_addr != short_addr) return;
+        int64_t now = esp_timer_get_time();
+        if (now - parent_unavailable_us > (int64_t)ZB_REJOIN_PARENT_UNAVAILABLE_WINDOW_MS * 1000) parent_unavailable = 0;
+        parent_unavailable_us = now;
+        if (++parent_unavailable >= ZB_REJOIN_PARENT_UNAVAILABLE_LIMIT) zb_rejoin_link_lost();
+        return;
+    }
+}
+
+void zb_rejoin_failed(void)
+{
+    stats.failures++;
+
+    if (!cycle_active) {
+        // Failure of the stack's own start-up rejoin: that was the first stored attempt
+        cycle_active = true;
+        cycle_commissioned = true;
+        cycle_attempts = 1;
+        cycle_stage = ZB_REJOIN_STAGE_STORED;
+        cycle_start_us = esp_timer_get_time();
+        stats.attempts++;
+    }
+
+    // Full jitter over the upper half of an exponentially growing window
+    uint32_t shift = cycle_attempts > 6 ? 6 : cycle_attempts - 1;
+    uint32_t window = ZB_REJOIN_BACKOFF_MIN_MS << shift;
+    if (window > ZB_REJOIN_BACKOFF_MAX_MS) window = ZB_REJOIN_BACKOFF_MAX_MS;
+    uint32_t delay = window / 2 + esp_random() % (window / 2 + 1);
+
+    ESP_LOGI(TAG, "Attempt %lu failed, next in %lu ms", (unsigned long)cycle_attempts, (unsigned long)delay);
+    esp_zb_scheduler_alarm(zb_rejoin_attempt, 0, delay);
+}
+
+void zb_rejoin_succeeded(void)
+{
+    parent_unavailable = 0;
+    esp_zb_ieee_addr_t ext_pan_id;
+    esp_zb_get_extended_pan_id(ext_pan_id);
+    uint8_t channel = esp_zb_get_current_channel();
+
+    if (channel != net.channel || memcmp(ext_pan_id, net.ext_pan_id, sizeof(ext_pan_id)) != 0) {
+        net.channel = channel;
+        memcpy(net.ext_pan_id, ext_pan_id, sizeof(ext_pan_id));
+        stats.channel = channel;
+        zb_net_save();
+    }
+
+    if (cycle_active) {
+        uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - cycle_start_us) / 1000);
+        stats.rejoins++;
+        stats.last_attempts = cycle_attempts;
+        stats.last_rejoin_ms = elapsed_ms;
+        stats.last_stage = cycle_stage;
+        if (elapsed_ms > stats.max_rejoin_ms) stats.max_rejoin_ms = elapsed_ms;
+        cycle_active = false;
+
+        ESP_LOGI(TAG, "On network (channel %d) after %lu attempts, %lu ms, stage %d", channel,
+                 (unsigned long)stats.last_attempts, (unsigned long)elapsed_ms, stats.last_stage);
+    }
+}
+
+void zb_rejoin_forget(void)
+{
+    memset(&net, 0, sizeof(net));
+    stats.channel = 0;
+    zb_net_save();
+}
+
+void zb_rejoin_get_stats(zb_rejoin_stats_t *out)
+{
+    *out = stats;
+}
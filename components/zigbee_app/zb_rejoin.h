@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Join/rejoin policy. The channel and extended PAN ID of the last network are persisted. A lost
+// lamp first rejoins from the stack's stored network information, then steers on the last
+// channel for the last PAN, then on the last channel plus the common Zigbee channels, and
+// finally on all 16 channels for any PAN. Each stage gets ZB_REJOIN_ATTEMPTS_PER_STAGE attempts;
+// stages with nothing persisted behind them are skipped. Attempts are spaced by a randomised
+// exponential backoff, so lamps that lost the same coordinator do not scan in lockstep.
+#define ZB_REJOIN_BACKOFF_MIN_MS    1000
+#define ZB_REJOIN_BACKOFF_MAX_MS    60000
+#define ZB_REJOIN_ATTEMPTS_PER_STAGE 2
+#define ZB_REJOIN_PREFERRED_CHANNELS ((1UL << 11) | (1UL << 15) | (1UL << 20) | (1UL << 25))
+// Undeliverable frames to our parent, each within the window of the previous one, before the
+// link counts as lost
+#define ZB_REJOIN_PARENT_UNAVAILABLE_LIMIT     3
+#define ZB_REJOIN_PARENT_UNAVAILABLE_WINDOW_MS 60000
+
+typedef enum {
+    ZB_REJOIN_STAGE_STORED,        // BDB initialisation from the stack's own network info
+    ZB_REJOIN_STAGE_LAST_CHANNEL,  // steering on the persisted channel, persisted PAN only
+    ZB_REJOIN_STAGE_PREFERRED,     // steering on the persisted channel and 11/15/20/25, any PAN
+    ZB_REJOIN_STAGE_ALL,           // steering on all 16 channels, any PAN
+    ZB_REJOIN_STAGE_COUNT,
+} zb_rejoin_stage_t;
+
+typedef struct {
+    uint32_t attempts;         // commissioning attempts started, all cycles
+    uint32_t failures;         // attempts that failed
+    uint32_t rejoins;          // cycles that ended on a network
+    uint32_t last_attempts;    // attempts needed by the last successful cycle
+    uint32_t last_rejoin_ms;   // time from losing the network to being back on it
+    uint32_t max_rejoin_ms;
+    uint8_t last_stage;        // zb_rejoin_stage_t that succeeded last
+    uint8_t channel;           // persisted channel, 0 if none
+} zb_rejoin_stats_t;
+
+// Load the persisted network before esp_zb_start()
+void zb_rejoin_init(void);
+
+// Channel sets for the stack's start-up; after esp_zb_init(), before esp_zb_start(). Each
+// steering attempt later sets the masks and PAN of its stage.
+void zb_rejoin_configure(void);
+
+// A network is persisted, i.e. the lamp was commissioned when it last ran. Valid after
+// zb_rejoin_init().
+bool zb_rejoin_has_network(void);
+
+// Start a join cycle. commissioned: the stack still has network info (reboot or parent loss);
+// false for a factory-new lamp.
+void zb_rejoin_begin(bool commissioned);
+
+// The parent or all links are gone (NLME parent link failure, no active links left): rejoin
+// from the stored network unless a cycle already runs
+void zb_rejoin_link_lost(void);
+
+// Device unavailable signal; repeated failures towards our parent count as a lost link
+void zb_rejoin_device_unavailable(uint16_t short_addr);
+
+// The last commissioning attempt failed; the next one is scheduled after a backoff
+void zb_rejoin_failed(void);
+
+// On a network: persist channel and PAN if they changed and close the cycle metrics
+void zb_rejoin_succeeded(void);
+
+// Left the network for good: drop the persisted channel and PAN
+void zb_rejoin_forget(void);
+
+void zb_rejoin_get_stats(zb_rejoin_stats_t *out);
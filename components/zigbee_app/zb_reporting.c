@@ -0,0 +1,147 @@
+#include "zb_reporting.h"
+#include "zigbee_app.h"
+#include "esp_log.h"
+#include "esp_zigbee_core.h"
+#include "esp_timer.h"
+
+static const char *TAG = "ZB_REPORT";
+
+typedef struct {
+    uint16_t cluster_id;
+    uint16_t attr_id;
+    uint8_t size;
+    uint16_t delta;
+} light_report_attr_t;
+
+static const light_report_attr_t report_attrs[] = {
+    { ESP_ZB_ZCL_CLUSTER_ID_ON_OFF,        ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID,                          1, 0 },
+    { ESP_ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL, ESP_ZB_ZCL_ATTR_LEVEL_CONTROL_CURRENT_LEVEL_ID,             1, LIGHT_REPORT_LEVEL_DELTA },
+    { ESP_ZB_ZCL_CLUSTER_ID_COLOR_CONTROL, ESP_ZB_ZCL_ATTR_COLOR_CONTROL_COLOR_TEMPERATURE_ID,         2, LIGHT_REPORT_MIRED_DELTA },
+};
+#define REPORT_ATTR_COUNT (sizeof(report_attrs) / sizeof(report_attrs[0]))
+
+#define REPORTING_NOT_NEEDED    0xFFFF  // max interval set by a hub that turned reporting off
+#define REPORTING_HOLD_S        0xFFFE  // min and max interval while a burst is held back
+
+static light_report_stats_t stats;
+static uint8_t pending = 0;     // bit per report_attrs entry changed in the current burst
+static uint8_t held = 0;        // bit per report_attrs entry this module paused for the burst
+static esp_zb_zcl_reporting_info_t saved[REPORT_ATTR_COUNT];   // configuration before the pause
+static int64_t settle_at_us = 0;    // end of the longest fade in the burst plus the settle time
+
+static esp_zb_zcl_attr_location_info_t attr_location(const light_report_attr_t *a)
+{
+    esp_zb_zcl_attr_location_info_t info = {
+        .endpoint_id = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT,
+        .cluster_id = a->cluster_id,
+        .cluster_role = ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        .manuf_code = ESP_ZB_ZCL_ATTR_NON_MANUFACTURER_SPECIFIC,
+        .attr_id = a->attr_id,
+    };
+    return info;
+}
+
+void light_reporting_init(void)
+{
+    for (size_t i = 0; i < REPORT_ATTR_COUNT; i++) {
+        const light_report_attr_t *a = &report_attrs[i];
+        esp_zb_zcl_reporting_info_t info = {
+            .direction = ESP_ZB_ZCL_REPORT_DIRECTION_SEND,
+            .ep = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT,
+            .cluster_id = a->cluster_id,
+            .cluster_role = ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+            .dst.profile_id = ESP_ZB_AF_HA_PROFILE_ID,
+            .u.send_info.min_interval = LIGHT_REPORT_MIN_S,
+            .u.send_info.max_interval = LIGHT_REPORT_MAX_S,
+            .u.send_info.def_min_interval = LIGHT_REPORT_MIN_S,
+            .u.send_info.def_max_interval = LIGHT_REPORT_MAX_S,
+            .attr_id = a->attr_id,
+            .manuf_code = ESP_ZB_ZCL_ATTR_NON_MANUFACTURER_SPECIFIC,
+        };
+        if (a->size == 1) {
+            info.u.send_info.delta.u8 = (uint8_t)a->delta;
+        } else {
+            info.u.send_info.delta.u16 = a->delta;
+        }
+        esp_err_t err = esp_zb_zcl_update_reporting_info(&info);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Reporting for 0x%04x/0x%04x not set: %s", a->cluster_id, a->attr_id, esp_err_to_name(err));
+        }
+    }
+}
+
+// Pause automatic reports of one attribute for the burst: both intervals at REPORTING_HOLD_S, the
+// configuration in force kept for the resume. Reporting the hub switched off is left alone.
+static void light_reporting_hold(size_t i)
+{
+    esp_zb_zcl_reporting_info_t *info = esp_zb_zcl_find_reporting_info(attr_location(&report_attrs[i]));
+    if (info == NULL || info->u.send_info.max_interval == REPORTING_NOT_NEEDED) return;
+
+    saved[i] = *info;
+    esp_zb_zcl_reporting_info_t hold = *info;
+    hold.u.send_info.min_interval = REPORTING_HOLD_S;
+    hold.u.send_info.max_interval = REPORTING_HOLD_S;
+    if (esp_zb_zcl_update_reporting_info(&hold) == ESP_OK) {
+        held |= 1u << i;
+        stats.holds++;
+    }
+}
+
+// The fades are over and nothing changed for LIGHT_REPORT_SETTLE_MS: give the reporting engine
+// its configuration back. The last value it reported is still the one from before the burst, so
+// it sends the final value once, or nothing if the burst ended where it started.
+static void light_reporting_settled(uint8_t param)
+{
+    (void)param;
+    stats.bursts++;
+
+    for (size_t i = 0; i < REPORT_ATTR_COUNT; i++) {
+        if (!(held & (1u << i))) continue;
+
+        // A Configure Reporting from the hub during the burst replaced the hold; keep the hub's
+        esp_zb_zcl_reporting_info_t *info = esp_zb_zcl_find_reporting_info(attr_location(&report_attrs[i]));
+        if (info && (info->u.send_info.min_interval != REPORTING_HOLD_S ||
+                     info->u.send_info.max_interval != REPORTING_HOLD_S)) {
+            continue;
+        }
+        esp_err_t err = esp_zb_zcl_update_reporting_info(&saved[i]);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Reporting for 0x%04x/0x%04x not resumed: %s", report_attrs[i].cluster_id,
+                     report_attrs[i].attr_id, esp_err_to_name(err));
+        }
+    }
+
+    ESP_LOGD(TAG, "Settled: changes=%lu bursts=%lu holds=%lu", (unsigned long)stats.changes,
+             (unsigned long)stats.bursts, (unsigned long)stats.holds);
+    pending = 0;
+    held = 0;
+}
+
+void light_reporting_changed(uint16_t cluster_id, uint16_t attr_id, uint32_t fade_ms)
+{
+    for (size_t i = 0; i < REPORT_ATTR_COUNT; i++) {
+        if (report_attrs[i].cluster_id != cluster_id || report_attrs[i].attr_id != attr_id) continue;
+
+        stats.changes++;
+        if (pending == 0) {
+            // First change of a burst: hold automatic reports of every light attribute, so a
+            // level change that also switches the light on reports both once
+            for (size_t j = 0; j < REPORT_ATTR_COUNT; j++) light_reporting_hold(j);
+        }
+        pending |= 1u << i;
+
+        // A short fade after a long one still waits for the long one to finish
+        int64_t now = esp_timer_get_time();
+        int64_t settle_at = now + ((int64_t)fade_ms + LIGHT_REPORT_SETTLE_MS) * 1000;
+        if (settle_at > settle_at_us) settle_at_us = settle_at;
+
+        esp_zb_scheduler_alarm_cancel(light_reporting_settled, 0);
+        esp_zb_scheduler_alarm(light_reporting_settled, 0, (uint32_t)((settle_at_us - now + 999) / 1000));
+        return;
+    }
+}
+
+void light_reporting_get_stats(light_report_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <stdint.h>
+
+// Attribute reporting for OnOff, CurrentLevel and ColorTemperatureMireds, so hubs do not have to
+// poll. Defaults below are installed before esp_zb_start(); a Configure Reporting command from the
+// hub replaces them and is kept by the stack.
+//
+// While a change is in progress (a ZCL transition steps the attribute many times) automatic
+// reports for the light attributes are paused through the reporting configuration; once the LED
+// fade of the last change has run out and LIGHT_REPORT_SETTLE_MS more passed without a change,
+// the configuration is restored and the reporting engine sends the final value once.
+// Attributes whose reporting the hub turned off (max interval 0xFFFF) are left alone, and so is
+// a configuration the hub sent during the burst.
+#define LIGHT_REPORT_MIN_S          1
+#define LIGHT_REPORT_MAX_S          600     // heartbeat
+#define LIGHT_REPORT_LEVEL_DELTA    1
+#define LIGHT_REPORT_MIRED_DELTA    1
+#define LIGHT_REPORT_SETTLE_MS      200     // after the end of the fade
+
+typedef struct {
+    uint32_t changes;     // light attribute updates seen
+    uint32_t bursts;      // settled bursts of changes (commands / fades)
+    uint32_t holds;       // reporting entries paused for a burst
+} light_report_stats_t;
+
+// Install the default reporting entries; call between esp_zb_device_register() and esp_zb_start()
+void light_reporting_init(void);
+
+// A light attribute changed and the LEDs fade to it over fade_ms; call from the attribute
+// handler (Zigbee task)
+void light_reporting_changed(uint16_t cluster_id, uint16_t attr_id, uint32_t fade_ms);
+
+void light_reporting_get_stats(light_report_stats_t *out);
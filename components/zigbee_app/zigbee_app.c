@@ -3,11 +3,22 @@
 #include "esp_check.h"
 #include "esp_zigbee_core.h"
 #include "ha/esp_zigbee_ha_standard.h"
+#include "zboss_api.h"
 #include <string.h>
-#include "tlc59108.h"
+#include "led_mailbox.h"
+#include "light_store.h"
+#include "esp_timer.h"
+#include "esp_system.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
+#include "esp_rom_crc.h"
+#include "state_journal.h"
+#include "boot_trace.h"
+#include "zb_rejoin.h"
+#include "zb_reporting.h"
+#include "sensor_sched.h"
+#include <stddef.h>
 
 static const char *TAG = "ZIGBEE_APP";
 
@@ -19,75 +30,318 @@ const uint16_t MID_TEMP = MIN_TEMP + (MAX_TEMP - MIN_TEMP)/2;
 int32_t new_mired = 0;
 int32_t mired = MID_TEMP;
 int32_t current_brightness = 128;
+bool light_on = true;
+light_startup_t light_startup = {
+    .on_off = LIGHT_STARTUP_PREVIOUS,
+    .level = ESP_ZB_ZCL_LEVEL_CONTROL_START_UP_CURRENT_LEVEL_USE_PREVIOUS_VALUE,
+    .mired = LIGHT_STARTUP_MIRED_PREVIOUS,
+};
 
 static bool zigbee_connected = false;
 
+// Held by the attribute handler while it changes the persisted state, and by snapshot readers
+static portMUX_TYPE light_state_lock = portMUX_INITIALIZER_UNLOCKED;
 
-void SaveToNVS()
+// Light state as last requested over Zigbee; published whole to the LED render task
+static led_target_t light_target = {
+    .level = 128,
+    .mired = MID_TEMP,
+};
+
+static zigbee_cb_stats_t attr_cb_stats;
+
+#define ATTR_CB_STATS_LOG_EVERY 100
+
+// The stack takes one ZCL send-status callback; zb_send_status_dispatch() counts every outcome and
+// passes it on to the handlers modules added
+#define SEND_STATUS_HANDLERS 4
+static esp_zb_zcl_command_send_status_callback_t send_status_handlers[SEND_STATUS_HANDLERS];
+static zigbee_send_stats_t send_stats;
+
+// Transition of the last Move to Level / Move to Color Temperature command. The stack steps the
+// attribute towards the command's target over the transition time; the LEDs fade straight to the
+// target over what is left of it, so the intermediate steps do not restart the fade.
+typedef struct {
+    uint16_t target;
+    int64_t end_us;     // 0: no commanded transition running
+} light_transition_t;
+
+static light_transition_t level_transition;
+static light_transition_t mired_transition;
+
+static void light_transition_start(light_transition_t *t, uint16_t target, uint16_t transition_ds)
 {
-    nvs_handle_t my_handle;
-    esp_err_t err;
+    // 0xFFFF: the command leaves the time to the device, which is the default fade
+    uint32_t ms = transition_ds == 0xFFFF ? LIGHT_TRANSITION_MS : (uint32_t)transition_ds * 100;
+    t->target = target;
+    t->end_us = esp_timer_get_time() + (int64_t)ms * 1000;
+}
+
+static bool light_transition_running(const light_transition_t *t, int64_t now)
+{
+    return t->end_us != 0 && now < t->end_us;
+}
+
+// Fade length for a change of this attribute to value: the rest of a commanded transition, none
+// for the stack's last step onto its target (the LEDs faded there with the transition), or the
+// default when the change did not come from one
+static uint32_t light_transition_ms(const light_transition_t *t, int32_t value)
+{
+    int64_t now = esp_timer_get_time();
+    if (light_transition_running(t, now)) return (uint32_t)((t->end_us - now + 999) / 1000);
+    if (t->end_us != 0 && value == t->target) return 0;
+    return LIGHT_TRANSITION_MS;
+}
+
+static void light_publish(uint32_t transition_ms)
+{
+    int64_t now = esp_timer_get_time();
+    int32_t level = light_transition_running(&level_transition, now) ? level_transition.target : current_brightness;
+
+    light_target.level = light_on ? (uint8_t)level : 0;
+    light_target.mired = light_transition_running(&mired_transition, now) ? mired_transition.target : (uint16_t)mired;
+    light_target.transition_ms = transition_ms;
+    led_mailbox_publish(&light_target);
+}
+
+
+// All persistent lamp state in one blob. Bump LIGHT_STATE_VERSION when the layout changes
+// and add the upgrade path to light_state_migrate().
+#define LIGHT_STATE_NAMESPACE "storage"
+#define LIGHT_STATE_KEY       "light_state"
+#define LIGHT_STATE_VERSION   2
+
+typedef struct __attribute__((packed)) {
+    uint8_t version;
+    uint8_t on_off;
+    uint8_t level;            // Zigbee CurrentLevel
+    uint8_t startup_on_off;   // ZCL StartUpOnOff
+    uint16_t mired;
+    uint16_t startup_mired;   // ZCL StartUpColorTemperatureMireds
+    uint8_t startup_level;    // ZCL StartUpCurrentLevel
+    uint8_t reserved[3];
+    uint32_t crc;             // CRC32 of all bytes above
+} light_state_blob_t;
+
+// Version 1 layout: version, on_off, level, pad, mired (u16), pad (u16), crc
+#define LIGHT_STATE_V1_SIZE      12
+#define LIGHT_STATE_V1_CRC_AT    8
+
+static uint32_t light_state_crc(const light_state_blob_t *blob)
+{
+    return esp_rom_crc32_le(0, (const uint8_t *)blob, offsetof(light_state_blob_t, crc));
+}
 
-    err = nvs_open("storage", NVS_READWRITE, &my_handle);
+void light_state_snapshot(light_state_t *out)
+{
+    portENTER_CRITICAL(&light_state_lock);
+    out->level = current_brightness;
+    out->mired = mired;
+    out->on = light_on;
+    out->startup = light_startup;
+    portEXIT_CRITICAL(&light_state_lock);
+}
+
+static void light_state_pack(const light_state_t *state, light_state_blob_t *blob)
+{
+    memset(blob, 0, sizeof(*blob));
+    blob->version = LIGHT_STATE_VERSION;
+    blob->on_off = state->on;
+    blob->level = (uint8_t)state->level;
+    blob->mired = (uint16_t)state->mired;
+    blob->startup_on_off = state->startup.on_off;
+    blob->startup_level = state->startup.level;
+    blob->startup_mired = state->startup.mired;
+    blob->crc = light_state_crc(blob);
+}
+
+static void light_state_unpack(const light_state_blob_t *blob)
+{
+    light_on = blob->on_off != 0;
+    current_brightness = blob->level;
+    mired = blob->mired;
+    light_startup.on_off = blob->startup_on_off;
+    light_startup.level = blob->startup_level;
+    light_startup.mired = blob->startup_mired;
+}
+
+static esp_err_t light_state_write(nvs_handle_t handle, const light_state_blob_t *blob)
+{
+    esp_err_t err = nvs_set_blob(handle, LIGHT_STATE_KEY, blob, sizeof(*blob));
     if (err != ESP_OK) {
-        ESP_LOGW("SAVE", "nvs_open failed: %s", esp_err_to_name(err));
-        return;
+        ESP_LOGW("SAVE", "Failed to save light state: %s", esp_err_to_name(err));
+        return err;
     }
+    return nvs_commit(handle);
+}
 
-    err = nvs_set_i32(my_handle, "saved_color", (int32_t)mired);
-    if (err != ESP_OK) {
-        ESP_LOGW("SAVE", "Failed to save color: %s", esp_err_to_name(err));
-        goto out;
+// Validate a stored blob and bring it up to LIGHT_STATE_VERSION
+static esp_err_t light_state_migrate(light_state_blob_t *blob, size_t size)
+{
+    if (size == sizeof(*blob) && blob->version == LIGHT_STATE_VERSION) {
+        return blob->crc == light_state_crc(blob) ? ESP_OK : ESP_ERR_INVALID_CRC;
+    }
+
+    if (size == LIGHT_STATE_V1_SIZE && blob->version == 1) {
+        uint32_t crc;
+        memcpy(&crc, (const uint8_t *)blob + LIGHT_STATE_V1_CRC_AT, sizeof(crc));
+        if (crc != esp_rom_crc32_le(0, (const uint8_t *)blob, LIGHT_STATE_V1_CRC_AT)) {
+            return ESP_ERR_INVALID_CRC;
+        }
+        // Version 1 had no startup attributes: keep restoring the previous state
+        blob->startup_on_off = LIGHT_STARTUP_PREVIOUS;
+        blob->startup_level = ESP_ZB_ZCL_LEVEL_CONTROL_START_UP_CURRENT_LEVEL_USE_PREVIOUS_VALUE;
+        blob->startup_mired = LIGHT_STARTUP_MIRED_PREVIOUS;
+        memset(blob->reserved, 0, sizeof(blob->reserved));
+        blob->version = LIGHT_STATE_VERSION;
+        blob->crc = light_state_crc(blob);
+        return ESP_OK;
     }
 
-    //int32_t brightness_save = (current_brightness >= 100) ? (int32_t)current_brightness : 100;
-    int32_t brightness_save = current_brightness;
-    err = nvs_set_i32(my_handle, "brightness", brightness_save);
+    return size == sizeof(*blob) ? ESP_ERR_INVALID_VERSION : ESP_ERR_INVALID_SIZE;
+}
+
+// Forward migration from the separate "saved_color"/"brightness" keys used before the blob
+static esp_err_t light_state_load_legacy(nvs_handle_t handle, light_state_blob_t *blob)
+{
+    int32_t saved_color = 0;
+    int32_t saved_brightness = 0;
+
+    esp_err_t err = nvs_get_i32(handle, "saved_color", &saved_color);
+    if (err != ESP_OK) return err;
+    err = nvs_get_i32(handle, "brightness", &saved_brightness);
+    if (err != ESP_OK) return err;
+
+    ESP_LOGI("LOAD", "Migrating legacy keys (%i brightness, %i mired)", (int)saved_brightness, (int)saved_color);
+    current_brightness = saved_brightness;
+    mired = saved_color;
+    light_state_t state;
+    light_state_snapshot(&state);
+    light_state_pack(&state, blob);
+
+    err = light_state_write(handle, blob);
+    if (err == ESP_OK) {
+        nvs_erase_key(handle, "saved_color");
+        nvs_erase_key(handle, "brightness");
+        err = nvs_commit(handle);
+    }
+    return err;
+}
+
+static esp_err_t light_state_load_nvs(light_state_blob_t *blob)
+{
+    nvs_handle_t my_handle;
+    esp_err_t err = nvs_open(LIGHT_STATE_NAMESPACE, NVS_READWRITE, &my_handle);
+    if (err != ESP_OK) return err;
+
+    size_t size = sizeof(*blob);
+    err = nvs_get_blob(my_handle, LIGHT_STATE_KEY, blob, &size);
+    if (err == ESP_OK) {
+        err = light_state_migrate(blob, size);
+    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+        err = light_state_load_legacy(my_handle, blob);
+    }
+    nvs_close(my_handle);
+    return err;
+}
+
+// ZCL power-on behaviour, applied once to the restored state
+static void light_state_apply_startup(void)
+{
+    switch (light_startup.on_off) {
+    case LIGHT_STARTUP_OFF:    light_on = false; break;
+    case LIGHT_STARTUP_ON:     light_on = true; break;
+    case LIGHT_STARTUP_TOGGLE: light_on = !light_on; break;
+    default:                   break;
+    }
+
+    if (light_startup.level == 0) {
+        current_brightness = 1;   // "minimum level"
+    } else if (light_startup.level != ESP_ZB_ZCL_LEVEL_CONTROL_START_UP_CURRENT_LEVEL_USE_PREVIOUS_VALUE) {
+        current_brightness = light_startup.level;
+    }
+
+    if (light_startup.mired != LIGHT_STARTUP_MIRED_PREVIOUS) {
+        mired = light_startup.mired;
+    }
+    if (mired < MIN_TEMP) mired = MIN_TEMP;
+    if (mired > MAX_TEMP) mired = MAX_TEMP;
+}
+
+// The journal partition takes the frequent saves; NVS is only used on partition tables
+// without one, and read as a fallback so a device upgrading to the journal keeps its state.
+void SaveToNVS(const light_state_t *state)
+{
+    nvs_handle_t my_handle;
+    esp_err_t err;
+
+    light_state_blob_t blob;
+    light_state_pack(state, &blob);
+
+    if (state_journal_is_mounted()) {
+        err = state_journal_append(&blob, sizeof(blob));
+        if (err == ESP_OK) {
+            ESP_LOGI("SAVE", "Journal append OK (%u bytes)", (unsigned)sizeof(blob));
+            return;
+        }
+        ESP_LOGW("SAVE", "Journal append failed: %s, using NVS", esp_err_to_name(err));
+    }
+
+    err = nvs_open(LIGHT_STATE_NAMESPACE, NVS_READWRITE, &my_handle);
     if (err != ESP_OK) {
-        ESP_LOGW("SAVE", "Failed to save brightness: %s", esp_err_to_name(err));
-        goto out;
+        ESP_LOGW("SAVE", "nvs_open failed: %s", esp_err_to_name(err));
+        return;
     }
 
-    err = nvs_commit(my_handle);
+    err = light_state_write(my_handle, &blob);
     if (err != ESP_OK) {
         ESP_LOGW("SAVE", "nvs_commit failed: %s", esp_err_to_name(err));
     } else {
-        ESP_LOGI("SAVE", "NVS commit OK");
+        ESP_LOGI("SAVE", "NVS commit OK (%u bytes)", (unsigned)sizeof(blob));
     }
-    
 
-out:
     nvs_close(my_handle);
 }
 
-void LoadFromNVS(){
-    nvs_handle_t my_handle;
-    esp_err_t err = nvs_open("storage", NVS_READWRITE, &my_handle);
-    
-    int32_t saved_color = MID_TEMP; 
-    err = nvs_get_i32(my_handle, "saved_color", &saved_color);
-    ESP_LOGI(TAG, "Loaded %i mired from NVS", (int)saved_color);
-    switch (err) {
-        case ESP_OK:                    ESP_LOGI("LOAD", "Found color temperature value: %i", (int)saved_color); break;
-        case ESP_ERR_NVS_NOT_FOUND:     ESP_LOGW("LOAD", "Color temperature value is not found. Default color temperature value (%i) used", (int)MID_TEMP); break;
-        default :                       ESP_LOGW("LOAD", "Reading error!!! Default color temperature value (%i) used", (int)MID_TEMP);
+bool LoadFromNVS(){
+    int64_t start = esp_timer_get_time();
+    light_state_blob_t blob;
+    const char *source = "journal";
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+
+    if (state_journal_is_mounted()) {
+        size_t size = sizeof(blob);
+        err = state_journal_read_latest(&blob, &size);
+        if (err == ESP_OK) {
+            err = light_state_migrate(&blob, size);
+        }
+    }
+    if (err != ESP_OK) {
+        source = "NVS";
+        err = light_state_load_nvs(&blob);
     }
 
-    mired = saved_color;
-
-    int32_t saved_brightness = current_brightness; 
-    err = nvs_get_i32(my_handle, "brightness", &saved_brightness);
-    ESP_LOGI(TAG, "Loaded %i brightness from NVS", (int)saved_brightness);
     switch (err) {
-        case ESP_OK:                    ESP_LOGI("LOAD", "Found brightness value: %i", (int)saved_brightness); break;
-        case ESP_ERR_NVS_NOT_FOUND:     ESP_LOGW("LOAD", "Brightness value is not found. Default brightness value (%i) used", (int)current_brightness); break;
-        default :                       ESP_LOGW("LOAD", "Reading error!!! Default brightness value (%i) used", (int)current_brightness);
+        case ESP_OK:                    break;
+        case ESP_ERR_NVS_NOT_FOUND:     ESP_LOGW("LOAD", "Light state not found. Defaults used"); break;
+        default :                       ESP_LOGW("LOAD", "Reading error (%s). Defaults used", esp_err_to_name(err));
     }
 
-    current_brightness = saved_brightness;
-    ESP_LOGI(TAG, "Loaded %i brightness and %i mired from NVS", (int)current_brightness, (int)mired);
-    
+    if (err == ESP_OK) {
+        light_state_unpack(&blob);
+    }
+    bool was_on = light_on;
+    int32_t was_brightness = current_brightness;
+    int32_t was_mired = mired;
+    light_state_apply_startup();
+    if (err == ESP_OK && (light_on != was_on || current_brightness != was_brightness || mired != was_mired)) {
+        // Flash must follow, or TOGGLE never alternates and "previous" restores an older state
+        light_store_mark_dirty();
+    }
 
+    ESP_LOGI(TAG, "Loaded %s, %i brightness and %i mired from %s in %lld us", light_on ? "on" : "off",
+             (int)current_brightness, (int)mired, source, (long long)(esp_timer_get_time() - start));
+    return err == ESP_OK;
 }
 
 static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t *message)
@@ -98,15 +352,31 @@ static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t
     ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
     ESP_RETURN_ON_FALSE(message->info.status == ESP_ZB_ZCL_STATUS_SUCCESS, ESP_ERR_INVALID_ARG, TAG, "Received message: error status(%d)",
                         message->info.status);
-    ESP_LOGI(TAG, "Received message: endpoint(%d), cluster(0x%x), attribute(0x%x), data size(%d)", message->info.dst_endpoint, message->info.cluster,
+    ESP_LOGD(TAG, "Received message: endpoint(%d), cluster(0x%x), attribute(0x%x), data size(%d)", message->info.dst_endpoint, message->info.cluster,
              message->attribute.id, message->attribute.data.size);
     if (message->info.dst_endpoint == HA_COLOR_DIMMABLE_LIGHT_ENDPOINT) {
         switch (message->info.cluster) {
         case ESP_ZB_ZCL_CLUSTER_ID_ON_OFF:
             if (message->attribute.id == ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID && message->attribute.data.type == ESP_ZB_ZCL_ATTR_TYPE_BOOL) {
                 light_state = message->attribute.data.value ? *(bool *)message->attribute.data.value : light_state;
-                ESP_LOGI(TAG, "Light sets to %s", light_state ? "On" : "Off");
-                //light_driver_set_power(light_state);
+                ESP_LOGD(TAG, "Light sets to %s", light_state ? "On" : "Off");
+                if (light_state != light_on) {
+                    // Move to Level with On/Off switches on and fades up in one transition; the
+                    // switch itself has no level to land on (-1)
+                    uint32_t fade_ms = light_transition_ms(&level_transition, -1);
+                    light_reporting_changed(message->info.cluster, message->attribute.id, fade_ms);
+                    portENTER_CRITICAL(&light_state_lock);
+                    light_on = light_state;
+                    portEXIT_CRITICAL(&light_state_lock);
+                    light_publish(fade_ms);
+                    light_store_mark_dirty();
+                }
+            } else if (message->attribute.id == ESP_ZB_ZCL_ATTR_ON_OFF_START_UP_ON_OFF && message->attribute.data.value) {
+                portENTER_CRITICAL(&light_state_lock);
+                light_startup.on_off = *(uint8_t *)message->attribute.data.value;
+                portEXIT_CRITICAL(&light_state_lock);
+                ESP_LOGI(TAG, "StartUpOnOff sets to 0x%02x", light_startup.on_off);
+                light_store_mark_dirty();
             } else {
                 ESP_LOGW(TAG, "On/Off cluster data: attribute(0x%x), type(0x%x)", message->attribute.id, message->attribute.data.type);
             }
@@ -116,22 +386,46 @@ static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t
             if (message->attribute.id == ESP_ZB_ZCL_ATTR_COLOR_CONTROL_COLOR_TEMPERATURE_ID && message->attribute.data.type == ESP_ZB_ZCL_ATTR_TYPE_U16)
                 {
                     uint16_t new_mired = *(uint16_t *)message->attribute.data.value;
-                    led_color_temperature_control(current_brightness, new_mired);
-                    ESP_LOGI(TAG, "Color sets to %i", (int)new_mired);
+                    ESP_LOGD(TAG, "Color sets to %i", (int)new_mired);
                     if (new_mired != mired) {
+                        uint32_t fade_ms = light_transition_ms(&mired_transition, new_mired);
+                        light_reporting_changed(message->info.cluster, message->attribute.id, fade_ms);
+                        portENTER_CRITICAL(&light_state_lock);
                         mired = new_mired;
-                        SaveToNVS(mired, current_brightness);
+                        portEXIT_CRITICAL(&light_state_lock);
+                        light_publish(fade_ms);
+                        light_store_mark_dirty();
                     }
                     
                 }
+            else if (message->attribute.id == ESP_ZB_ZCL_ATTR_COLOR_CONTROL_START_UP_COLOR_TEMPERATURE_MIREDS_ID && message->attribute.data.value)
+                {
+                    portENTER_CRITICAL(&light_state_lock);
+                    light_startup.mired = *(uint16_t *)message->attribute.data.value;
+                    portEXIT_CRITICAL(&light_state_lock);
+                    ESP_LOGI(TAG, "StartUpColorTemperatureMireds sets to %u", light_startup.mired);
+                    light_store_mark_dirty();
+                }
             break;
         case ESP_ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL:
             if (message->attribute.id == ESP_ZB_ZCL_ATTR_LEVEL_CONTROL_CURRENT_LEVEL_ID && message->attribute.data.type == ESP_ZB_ZCL_ATTR_TYPE_U8) {
                 light_level = message->attribute.data.value ? *(uint8_t *)message->attribute.data.value : light_level;
-                current_brightness = light_level;
-                led_apply_brightness_and_ct(current_brightness, mired);
-                ESP_LOGI(TAG, "Light level changes to %d", light_level);
-                SaveToNVS(mired, current_brightness);
+                ESP_LOGD(TAG, "Light level changes to %d", light_level);
+                if (light_level != current_brightness) {
+                    uint32_t fade_ms = light_transition_ms(&level_transition, light_level);
+                    light_reporting_changed(message->info.cluster, message->attribute.id, fade_ms);
+                    portENTER_CRITICAL(&light_state_lock);
+                    current_brightness = light_level;
+                    portEXIT_CRITICAL(&light_state_lock);
+                    light_publish(fade_ms);
+                    light_store_mark_dirty();
+                }
+            } else if (message->attribute.id == ESP_ZB_ZCL_ATTR_LEVEL_CONTROL_START_UP_CURRENT_LEVEL_ID && message->attribute.data.value) {
+                portENTER_CRITICAL(&light_state_lock);
+                light_startup.level = *(uint8_t *)message->attribute.data.value;
+                portEXIT_CRITICAL(&light_state_lock);
+                ESP_LOGI(TAG, "StartUpCurrentLevel sets to %u", light_startup.level);
+                light_store_mark_dirty();
             } else {
                 ESP_LOGW(TAG, "Level Control cluster data: attribute(0x%x), type(0x%x)", message->attribute.id, message->attribute.data.type);
             }
@@ -144,6 +438,54 @@ static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t
 }
 
 
+// Sees every ZCL command before the stack handles it. Only the transition time of the light
+// commands is taken from the payload; processing is always left to the stack.
+static bool zb_raw_command_handler(uint8_t bufid)
+{
+    const zb_zcl_parsed_hdr_t *hdr = ZB_BUF_GET_PARAM(bufid, zb_zcl_parsed_hdr_t);
+    const uint8_t *payload = zb_buf_begin(bufid);
+    zb_uint_t len = zb_buf_len(bufid);
+
+    if (hdr->is_common_command || hdr->addr_data.common_data.dst_endpoint != HA_COLOR_DIMMABLE_LIGHT_ENDPOINT) {
+        return false;
+    }
+
+    switch (hdr->cluster_id) {
+    case ESP_ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL:
+        // Level (u8), transition time (u16, 1/10 s)
+        if ((hdr->cmd_id == ESP_ZB_ZCL_CMD_LEVEL_CONTROL_MOVE_TO_LEVEL ||
+             hdr->cmd_id == ESP_ZB_ZCL_CMD_LEVEL_CONTROL_MOVE_TO_LEVEL_WITH_ON_OFF) && len >= 3) {
+            uint8_t level = payload[0] > 254 ? 254 : payload[0];
+            light_transition_start(&level_transition, level, (uint16_t)(payload[1] | payload[2] << 8));
+        } else {
+            // Move, Step and Stop: the stack's steps each fade with the default
+            level_transition.end_us = 0;
+        }
+        break;
+    case ESP_ZB_ZCL_CLUSTER_ID_COLOR_CONTROL:
+        // Mireds (u16), transition time (u16, 1/10 s)
+        if (hdr->cmd_id == ESP_ZB_ZCL_CMD_COLOR_CONTROL_MOVE_TO_COLOR_TEMPERATURE && len >= 4) {
+            uint16_t target = (uint16_t)(payload[0] | payload[1] << 8);
+            if (target < MIN_TEMP) target = MIN_TEMP;
+            if (target > MAX_TEMP) target = MAX_TEMP;
+            light_transition_start(&mired_transition, target, (uint16_t)(payload[2] | payload[3] << 8));
+        } else {
+            mired_transition.end_us = 0;
+        }
+        break;
+    default:
+        break;
+    }
+    return false;
+}
+
+static void zb_identify_handler(uint8_t identify_on)
+{
+    ESP_LOGI(TAG, "Identify %s", identify_on ? "start" : "stop");
+    light_target.identify = identify_on;
+    light_publish(0);
+}
+
 static esp_err_t zb_default_resp_handler(const esp_zb_zcl_cmd_default_resp_message_t *message)
 {
     ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty default resp message");
@@ -159,76 +501,75 @@ static esp_err_t zb_default_resp_handler(const esp_zb_zcl_cmd_default_resp_messa
     return ESP_OK;
 }
 
-void reportAttribute(uint8_t endpoint, uint16_t clusterID, uint16_t attributeID, void *value, uint8_t value_length)
+// Only updates the attribute; the reporting engine decides when a report is due (reportable
+// change, min/max interval) and sends it to the bound or configured destinations.
+static void zigbee_set_measurement(uint16_t cluster, uint16_t attr, int16_t value)
 {
-    esp_zb_zcl_report_attr_cmd_t cmd = {
-        .zcl_basic_cmd = {
-            .dst_addr_u.addr_short = 0x0001,
-            .dst_endpoint = endpoint,
-            .src_endpoint = endpoint,
-        },
-        .address_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
-        .clusterID = clusterID,
-        .attributeID = attributeID,
-    };
-    esp_zb_zcl_attr_t *value_r = esp_zb_zcl_get_attribute(endpoint, clusterID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, attributeID);
-    memcpy(value_r->data_p, value, value_length);
-    esp_zb_zcl_report_attr_cmd_req(&cmd);
+    esp_zb_zcl_status_t status = esp_zb_zcl_set_attribute_val(HA_COLOR_DIMMABLE_LIGHT_ENDPOINT, cluster,
+                                                              ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, attr, &value, false);
+    if (status != ESP_ZB_ZCL_STATUS_SUCCESS) {
+        ESP_LOGW(TAG, "Cluster 0x%04x attr 0x%04x not updated (status 0x%x)", cluster, attr, status);
+    }
 }
 
-void zigbee_update_temperature(float temperature)
+// Runs in the Zigbee task: copies the sensor scheduler's latest values into the measurement
+// clusters. Values not refreshed for SENSOR_STALE_MS (sensor failing) are left as they were.
+static void zigbee_publish_sensors(uint8_t param)
 {
-    int16_t measured_value = (int16_t)(temperature * 100); // centi-deg
+    int32_t value;
+    uint32_t age_ms;
 
-    if (!esp_zb_bdb_dev_joined()) {
-        ESP_LOGW(TAG, "Not joined yet, skipping temp update");
-        return;
+    if (esp_zb_bdb_dev_joined()) {
+        if (sensor_get(SENSOR_TC74_TEMPERATURE, &value, &age_ms) && age_ms < SENSOR_STALE_MS) {
+            zigbee_set_measurement(ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
+                                   ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID, (int16_t)value);
+        }
+        // MeasuredValue is in 0.1 kPa (hPa); ScaledValue carries 10 Pa steps with Scale -2
+        if (sensor_get(SENSOR_MS8607_PRESSURE, &value, &age_ms) && age_ms < SENSOR_STALE_MS) {
+            zigbee_set_measurement(ESP_ZB_ZCL_CLUSTER_ID_PRESSURE_MEASUREMENT,
+                                   ESP_ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_VALUE_ID, (int16_t)((value + 50) / 100));
+            zigbee_set_measurement(ESP_ZB_ZCL_CLUSTER_ID_PRESSURE_MEASUREMENT,
+                                   ESP_ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_SCALED_VALUE_ID, (int16_t)((value + 5) / 10));
+        }
     }
+    esp_zb_scheduler_alarm(zigbee_publish_sensors, 0, SENSOR_PUBLISH_MS);
+}
 
-    ESP_LOGI(TAG, "Updating temperature to %d (centi-deg)", measured_value);
-
-    esp_zb_lock_acquire(portMAX_DELAY);
-
-    // Update the local ZCL attribute value in the stack
-    esp_zb_zcl_attr_t *attr = esp_zb_zcl_get_attribute(
-        HA_COLOR_DIMMABLE_LIGHT_ENDPOINT,
-        ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
-        ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
-        ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID
-    );
 
-    if (attr && attr->data_p) {
-        memcpy(attr->data_p, &measured_value, sizeof(measured_value));
+// Outcome of every ZCL frame the stack sent, reports included
+static void zb_send_status_dispatch(esp_zb_zcl_command_send_status_message_t message)
+{
+    if (message.status == ESP_OK) {
+        send_stats.sent++;
     } else {
-        ESP_LOGW(TAG, "Temp attribute not found");
-        esp_zb_lock_release();
-        return;
+        send_stats.failed++;
+    }
+    for (size_t i = 0; i < SEND_STATUS_HANDLERS && send_status_handlers[i] != NULL; i++) {
+        send_status_handlers[i](message);
     }
-
-    // One-shot report
-    esp_zb_zcl_report_attr_cmd_t cmd = {0};
-    cmd.zcl_basic_cmd.dst_addr_u.addr_short = 0x0000; // coordinator
-    cmd.zcl_basic_cmd.src_endpoint = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT;
-    cmd.zcl_basic_cmd.dst_endpoint = 1;               // coordinator endpoint (often 1)
-    cmd.address_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT;
-    cmd.direction = ESP_ZB_ZCL_CMD_DIRECTION_TO_CLI;
-    cmd.clusterID = ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT;
-    cmd.attributeID = ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID;
-
-    esp_zb_zcl_report_attr_cmd_req(&cmd);
-
-    esp_zb_lock_release();
 }
 
-
 static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id, const void *message)
 {
     esp_err_t ret = ESP_OK;
 
     switch (callback_id) {
-    case ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID:
+    case ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID: {
+        int64_t start = esp_timer_get_time();
         ret = zb_attribute_handler((esp_zb_zcl_set_attr_value_message_t *)message);
+        uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+
+        attr_cb_stats.count++;
+        attr_cb_stats.total_us += elapsed;
+        if (elapsed > attr_cb_stats.max_us) attr_cb_stats.max_us = elapsed;
+        if (attr_cb_stats.count % ATTR_CB_STATS_LOG_EVERY == 0) {
+            ESP_LOGI(TAG, "Attribute callback: n=%lu avg=%lu us max=%lu us",
+                     (unsigned long)attr_cb_stats.count,
+                     (unsigned long)(attr_cb_stats.total_us / attr_cb_stats.count),
+                     (unsigned long)attr_cb_stats.max_us);
+        }
         break;
+    }
 
     case ESP_ZB_CORE_CMD_DEFAULT_RESP_CB_ID:
         ret = zb_default_resp_handler((const esp_zb_zcl_cmd_default_resp_message_t *)message);
@@ -246,9 +587,59 @@ static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id,
     return ret;
 }
    
+// Boot timeline as ZCL octet string: length byte, then one uint32 LE millisecond stamp per phase
+static uint8_t boot_trace_attr[1 + BOOT_TRACE_COUNT * 4];
+
+static void boot_trace_attr_update(void)
+{
+    boot_trace_attr[0] = (uint8_t)boot_trace_export(&boot_trace_attr[1], sizeof(boot_trace_attr) - 1);
+}
+
+// Network is up (joined or rejoined after reboot): close the boot timeline and publish it
+static void zigbee_boot_complete(void)
+{
+    static bool done = false;
+    if (done) return;
+    done = true;
+
+    boot_trace_mark(BOOT_JOINED);
+    boot_trace_print();
+    boot_trace_attr_update();
+    esp_zb_zcl_set_manufacturer_attribute_val(HA_COLOR_DIMMABLE_LIGHT_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_BASIC,
+                                              ESP_ZB_ZCL_CLUSTER_SERVER_ROLE, ZB_MANUFACTURER_CODE,
+                                              ATTRID_BOOT_TRACE, boot_trace_attr, false);
+    zigbee_publish_sensors(0);
+}
+
+// Table sizes must be set before esp_zb_init()
+static void zb_apply_table_preset(void)
+{
+    static const struct {
+        const char *name;
+        uint16_t network;
+        uint16_t src_bindings;
+        uint16_t dst_bindings;
+    } presets[] = {
+        [LAMP_TABLES_SMALL]  = { "small",   32,  8,  8 },
+        [LAMP_TABLES_MEDIUM] = { "medium",  64, 16, 16 },
+        [LAMP_TABLES_LARGE]  = { "large",  128, 32, 32 },
+    };
+    const typeof(presets[0]) *p = &presets[LAMP_TABLES_PRESET];
+
+    esp_zb_overall_network_size_set(p->network);
+    esp_zb_aps_src_binding_table_size_set(p->src_bindings);
+    esp_zb_aps_dst_binding_table_size_set(p->dst_bindings);
+    ESP_LOGI(TAG, "%s, %s tables (network %u, bindings %u/%u)", LAMP_ROUTER_ROLE ? "Router" : "End device",
+             p->name, p->network, p->src_bindings, p->dst_bindings);
+}
+
 void esp_zb_task(void *pvParameters)
 {
-    esp_zb_cfg_t zb_nwk_cfg = ESP_ZB_ZED_CONFIG();
+    boot_trace_mark(BOOT_ZB_TASK);
+    size_t heap_before = esp_get_free_heap_size();
+
+    zb_apply_table_preset();
+    esp_zb_cfg_t zb_nwk_cfg = ESP_ZB_LAMP_CONFIG();
     esp_zb_init(&zb_nwk_cfg);
 
     // Set up basic cluster configuration
@@ -271,6 +662,10 @@ void esp_zb_task(void *pvParameters)
     esp_zb_basic_cluster_add_attr(esp_zb_basic_cluster, ESP_ZB_ZCL_ATTR_BASIC_MANUFACTURER_NAME_ID, ManufacturerName);
     esp_zb_basic_cluster_add_attr(esp_zb_basic_cluster, ESP_ZB_ZCL_ATTR_BASIC_MODEL_IDENTIFIER_ID, ModelIdentifier);
     esp_zb_basic_cluster_add_attr(esp_zb_basic_cluster, ESP_ZB_ZCL_ATTR_BASIC_DATE_CODE_ID, DateCode);
+    boot_trace_attr_update();
+    esp_zb_cluster_add_manufacturer_attr(esp_zb_basic_cluster, ESP_ZB_ZCL_CLUSTER_ID_BASIC, ATTRID_BOOT_TRACE,
+                                         ZB_MANUFACTURER_CODE, ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING,
+                                         ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY, boot_trace_attr);
 
     // Set up identify cluster configuration
     esp_zb_identify_cluster_cfg_t identify_cluster_cfg = {
@@ -280,10 +675,12 @@ void esp_zb_task(void *pvParameters)
 
     
     // Set up on/off cluster configuration
+    // Attributes start from the state restored at power-on, not from defaults
     esp_zb_on_off_cluster_cfg_t on_off_cfg = {
-        .on_off = 0,
+        .on_off = light_on,
     };
     esp_zb_attribute_list_t *esp_zb_on_off_cluster = esp_zb_on_off_cluster_create(&on_off_cfg);
+    esp_zb_on_off_cluster_add_attr(esp_zb_on_off_cluster, ESP_ZB_ZCL_ATTR_ON_OFF_START_UP_ON_OFF, &light_startup.on_off);
 
     // Set up color control cluster configuration
     esp_zb_color_cluster_cfg_t esp_zb_color_cluster_cfg = { 
@@ -296,17 +693,19 @@ void esp_zb_task(void *pvParameters)
     };
     esp_zb_attribute_list_t *esp_zb_color_cluster = esp_zb_color_control_cluster_create(&esp_zb_color_cluster_cfg);
     // Add color control attributes
-    uint16_t color_attr = MID_TEMP;
+    uint16_t color_attr = (uint16_t)mired;
     uint16_t min_temp = MIN_TEMP;
     uint16_t max_temp = MAX_TEMP;
     esp_zb_color_control_cluster_add_attr(esp_zb_color_cluster, ESP_ZB_ZCL_ATTR_COLOR_CONTROL_COLOR_TEMPERATURE_ID, &color_attr);
     esp_zb_color_control_cluster_add_attr(esp_zb_color_cluster, ESP_ZB_ZCL_ATTR_COLOR_CONTROL_COLOR_TEMP_PHYSICAL_MIN_MIREDS_ID, &min_temp);
     esp_zb_color_control_cluster_add_attr(esp_zb_color_cluster, ESP_ZB_ZCL_ATTR_COLOR_CONTROL_COLOR_TEMP_PHYSICAL_MAX_MIREDS_ID, &max_temp);
+    esp_zb_color_control_cluster_add_attr(esp_zb_color_cluster, ESP_ZB_ZCL_ATTR_COLOR_CONTROL_START_UP_COLOR_TEMPERATURE_MIREDS_ID, &light_startup.mired);
     
     // Set up level control cluster configuration
     esp_zb_attribute_list_t *esp_zb_level_cluster = esp_zb_zcl_attr_list_create(ESP_ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL);
-    uint8_t level = 50;
+    uint8_t level = (uint8_t)current_brightness;
     esp_zb_level_cluster_add_attr(esp_zb_level_cluster, ESP_ZB_ZCL_ATTR_LEVEL_CONTROL_CURRENT_LEVEL_ID, &level);
+    esp_zb_level_cluster_add_attr(esp_zb_level_cluster, ESP_ZB_ZCL_ATTR_LEVEL_CONTROL_START_UP_CURRENT_LEVEL_ID, &light_startup.level);
 
     // Set up temperature measurement cluster configuration
     esp_zb_temperature_meas_cluster_cfg_t temperature_meas_cfg = {
@@ -315,6 +714,22 @@ void esp_zb_task(void *pvParameters)
         .max_value = 12500,
     };
     esp_zb_attribute_list_t *esp_zb_temperature_meas_cluster = esp_zb_temperature_meas_cluster_create(&temperature_meas_cfg);
+
+    // Pressure measurement (MS8607), range 10..2000 mbar
+    esp_zb_pressure_meas_cluster_cfg_t pressure_meas_cfg = {
+        .measured_value = ESP_ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_VALUE_UNKNOWN,
+        .min_value = 10,
+        .max_value = 2000,
+    };
+    esp_zb_attribute_list_t *esp_zb_pressure_meas_cluster = esp_zb_pressure_meas_cluster_create(&pressure_meas_cfg);
+    int16_t scaled_value = ESP_ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_VALUE_UNKNOWN;
+    int16_t min_scaled = 100;
+    int16_t max_scaled = 20000;
+    int8_t scale = -2;
+    esp_zb_pressure_meas_cluster_add_attr(esp_zb_pressure_meas_cluster, ESP_ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_SCALED_VALUE_ID, &scaled_value);
+    esp_zb_pressure_meas_cluster_add_attr(esp_zb_pressure_meas_cluster, ESP_ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_MIN_SCALED_VALUE_ID, &min_scaled);
+    esp_zb_pressure_meas_cluster_add_attr(esp_zb_pressure_meas_cluster, ESP_ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_MAX_SCALED_VALUE_ID, &max_scaled);
+    esp_zb_pressure_meas_cluster_add_attr(esp_zb_pressure_meas_cluster, ESP_ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_SCALE_ID, &scale);
     
     // Create cluster list and add clusters
     esp_zb_cluster_list_t *esp_zb_cluster_list = esp_zb_zcl_cluster_list_create();
@@ -322,6 +737,7 @@ void esp_zb_task(void *pvParameters)
     esp_zb_cluster_list_add_identify_cluster(esp_zb_cluster_list, esp_zb_identify_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
     esp_zb_cluster_list_add_on_off_cluster(esp_zb_cluster_list, esp_zb_on_off_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
     esp_zb_cluster_list_add_temperature_meas_cluster(esp_zb_cluster_list, esp_zb_temperature_meas_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+    esp_zb_cluster_list_add_pressure_meas_cluster(esp_zb_cluster_list, esp_zb_pressure_meas_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
     
     esp_zb_cluster_list_add_level_cluster(esp_zb_cluster_list, esp_zb_level_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
 
@@ -342,37 +758,54 @@ void esp_zb_task(void *pvParameters)
     esp_zb_ep_list_add_ep(esp_zb_ep_list, esp_zb_cluster_list, zb_endpoint_config);
     // Register device endpoint list
     esp_zb_device_register(esp_zb_ep_list);
+    boot_trace_mark(BOOT_ZB_REGISTERED);
 
-    // Configure temperature reporting
+    // Configure temperature reporting; Configure Reporting from the hub overrides these
     esp_zb_zcl_reporting_info_t temperature_report = {
-        .direction = ESP_ZB_ZCL_CMD_DIRECTION_TO_CLI,
+        .direction = ESP_ZB_ZCL_REPORT_DIRECTION_SEND,
         .ep = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT,
         .cluster_id = ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT,
         .cluster_role = ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
         .dst.profile_id = ESP_ZB_AF_HA_PROFILE_ID,
-        .u.send_info.min_interval = 2,
-        .u.send_info.max_interval = 10,
-        .u.send_info.def_min_interval = 2,
-        .u.send_info.def_max_interval = 10,
-        .u.send_info.delta.u16 = 0, 
+        .u.send_info.min_interval = TEMP_REPORT_MIN_S,
+        .u.send_info.max_interval = TEMP_REPORT_MAX_S,
+        .u.send_info.def_min_interval = TEMP_REPORT_MIN_S,
+        .u.send_info.def_max_interval = TEMP_REPORT_MAX_S,
+        .u.send_info.delta.s16 = TEMP_REPORT_DELTA,
         .attr_id = ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID,
         .manuf_code = ESP_ZB_ZCL_ATTR_NON_MANUFACTURER_SPECIFIC,
     };
 
     esp_zb_zcl_update_reporting_info(&temperature_report);
 
+    esp_zb_zcl_reporting_info_t pressure_report = {
+        .direction = ESP_ZB_ZCL_REPORT_DIRECTION_SEND,
+        .ep = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT,
+        .cluster_id = ESP_ZB_ZCL_CLUSTER_ID_PRESSURE_MEASUREMENT,
+        .cluster_role = ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        .dst.profile_id = ESP_ZB_AF_HA_PROFILE_ID,
+        .u.send_info.min_interval = PRESSURE_REPORT_MIN_S,
+        .u.send_info.max_interval = PRESSURE_REPORT_MAX_S,
+        .u.send_info.def_min_interval = PRESSURE_REPORT_MIN_S,
+        .u.send_info.def_max_interval = PRESSURE_REPORT_MAX_S,
+        .u.send_info.delta.s16 = PRESSURE_REPORT_DELTA,
+        .attr_id = ESP_ZB_ZCL_ATTR_PRESSURE_MEASUREMENT_VALUE_ID,
+        .manuf_code = ESP_ZB_ZCL_ATTR_NON_MANUFACTURER_SPECIFIC,
+    };
+    esp_zb_zcl_update_reporting_info(&pressure_report);
+    light_reporting_init();
+
     esp_zb_core_action_handler_register(zb_action_handler);
-    esp_zb_set_primary_network_channel_set(ESP_ZB_PRIMARY_CHANNEL_MASK);
+    esp_zb_raw_command_handler_register(zb_raw_command_handler);
+    esp_zb_zcl_command_send_status_handler_register(zb_send_status_dispatch);
+    esp_zb_identify_notify_handler_register(HA_COLOR_DIMMABLE_LIGHT_ENDPOINT, zb_identify_handler);
+    zb_rejoin_configure();
     ESP_ERROR_CHECK(esp_zb_start(false));
+    boot_trace_mark(BOOT_ZB_STARTED);
+    ESP_LOGI(TAG, "Zigbee stack heap: %u bytes", (unsigned)(heap_before - esp_get_free_heap_size()));
     esp_zb_stack_main_loop();
 }
 
-static void bdb_start_top_level_commissioning_cb(uint8_t mode_mask)
-{
-    ESP_RETURN_ON_FALSE(esp_zb_bdb_start_top_level_commissioning(mode_mask) == ESP_OK, ,
-                        TAG, "Failed to start Zigbee bdb commissioning");
-}
-
 
 void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
 {
@@ -382,27 +815,35 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
     switch (sig_type) {
 
     case ESP_ZB_ZDO_SIGNAL_SKIP_STARTUP:
+        boot_trace_mark(BOOT_BDB_INIT);
         ESP_LOGI(TAG, "Initialize Zigbee stack");
         esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_INITIALIZATION);
         break;
     case ESP_ZB_BDB_SIGNAL_DEVICE_FIRST_START:
     case ESP_ZB_BDB_SIGNAL_DEVICE_REBOOT:
         if (err_status == ESP_OK) {
+            boot_trace_mark(BOOT_BDB_DONE);
             ESP_LOGI(TAG, "Device started up in%s factory-reset mode", esp_zb_bdb_is_factory_new() ? "" : " non");
             if (esp_zb_bdb_is_factory_new()) {
                 ESP_LOGI(TAG, "Start network steering");
-                esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_STEERING);
+                boot_trace_mark(BOOT_STEERING);
+                if (zb_rejoin_has_network()) {
+                    // Stack storage was erased behind our back; the next boot is not a commissioned one
+                    zb_rejoin_forget();
+                }
+                zb_rejoin_begin(false);
             } else {
                 ESP_LOGI(TAG, "Device rebooted");
+                zb_rejoin_succeeded();
+                zigbee_boot_complete();
                 ESP_LOGI(TAG, "Applying saved LED state after reboot");
                 ESP_LOGI(TAG, "Vals: %i brightness and %i mired", (int)current_brightness, (int)mired);
-                led_color_temperature_control(current_brightness, mired);
+                light_publish(0);
             }
         } else {
             ESP_LOGW(TAG, "%s failed with status: %s, retrying", esp_zb_zdo_signal_to_string(sig_type),
                      esp_err_to_name(err_status));
-            esp_zb_scheduler_alarm((esp_zb_callback_t)bdb_start_top_level_commissioning_cb,
-                                   ESP_ZB_BDB_MODE_INITIALIZATION, 1000);
+            zb_rejoin_failed();
         }
         break;
     case ESP_ZB_BDB_SIGNAL_STEERING:
@@ -413,16 +854,73 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
                      extended_pan_id[7], extended_pan_id[6], extended_pan_id[5], extended_pan_id[4],
                      extended_pan_id[3], extended_pan_id[2], extended_pan_id[1], extended_pan_id[0],
                      esp_zb_get_pan_id(), esp_zb_get_current_channel(), esp_zb_get_short_address());
+            zb_rejoin_succeeded();
+            zigbee_boot_complete();
             ESP_LOGI(TAG, "Applying saved LED state after join");
             ESP_LOGI(TAG, "Vals: %i brightness and %i mired", (int)current_brightness, (int)mired);
-            led_color_temperature_control(current_brightness, mired);
+            light_publish(0);
+            // Persist once so the next power-up takes the fast-restore path
+            light_store_mark_dirty();
+#if LAMP_ROUTER_ROLE && LAMP_PERMIT_JOIN_S > 0
+            esp_zb_bdb_open_network(LAMP_PERMIT_JOIN_S);
+#endif
             
             
         } else {
             ESP_LOGI(TAG, "Network steering was not successful (status: %s)", esp_err_to_name(err_status));
-            esp_zb_scheduler_alarm((esp_zb_callback_t)bdb_start_top_level_commissioning_cb, ESP_ZB_BDB_MODE_NETWORK_STEERING, 1000);
+            zb_rejoin_failed();
         }
         break;
+    case ESP_ZB_NWK_SIGNAL_PERMIT_JOIN_STATUS:
+        if (err_status == ESP_OK) {
+            uint8_t *duration = (uint8_t *)esp_zb_app_signal_get_params(p_sg_p);
+            if (duration && *duration) {
+                ESP_LOGI(TAG, "Network open for joining for %d s", *duration);
+            } else {
+                ESP_LOGI(TAG, "Network closed for joining");
+            }
+        }
+        break;
+    case ESP_ZB_ZDO_SIGNAL_DEVICE_ANNCE: {
+        esp_zb_zdo_signal_device_annce_params_t *annce =
+            (esp_zb_zdo_signal_device_annce_params_t *)esp_zb_app_signal_get_params(p_sg_p);
+        ESP_LOGI(TAG, "Device 0x%04hx joined or rejoined", annce->device_short_addr);
+        break;
+    }
+    case ESP_ZB_NLME_STATUS_INDICATION: {
+        esp_zb_zdo_signal_nwk_status_indication_params_t *status =
+            (esp_zb_zdo_signal_nwk_status_indication_params_t *)esp_zb_app_signal_get_params(p_sg_p);
+        if (status && status->status == ESP_ZB_NWK_COMMAND_STATUS_PARENT_LINK_FAILURE) {
+            ESP_LOGW(TAG, "Parent link failure");
+            zb_rejoin_link_lost();
+        }
+        break;
+    }
+    case ESP_ZB_NWK_SIGNAL_NO_ACTIVE_LINKS_LEFT:
+        ESP_LOGW(TAG, "No active links left");
+        zb_rejoin_link_lost();
+        break;
+    case ESP_ZB_ZDO_DEVICE_UNAVAILABLE: {
+        esp_zb_zdo_device_unavailable_params_t *unavailable =
+            (esp_zb_zdo_device_unavailable_params_t *)esp_zb_app_signal_get_params(p_sg_p);
+        if (unavailable) {
+            ESP_LOGI(TAG, "Device 0x%04hx unavailable", unavailable->short_addr);
+            zb_rejoin_device_unavailable(unavailable->short_addr);
+        }
+        break;
+    }
+    case ESP_ZB_ZDO_SIGNAL_LEAVE: {
+        esp_zb_zdo_signal_leave_params_t *leave = (esp_zb_zdo_signal_leave_params_t *)esp_zb_app_signal_get_params(p_sg_p);
+        if (leave && leave->leave_type == ESP_ZB_NWK_LEAVE_TYPE_REJOIN) {
+            ESP_LOGI(TAG, "Left network with rejoin, looking for it again");
+            zb_rejoin_begin(true);
+        } else {
+            ESP_LOGI(TAG, "Left network, forgetting it");
+            zb_rejoin_forget();
+            zb_rejoin_begin(false);
+        }
+        break;
+    }
     default:
         ESP_LOGI(TAG, "ZDO signal: %s (0x%x), status: %s", esp_zb_zdo_signal_to_string(sig_type), sig_type,
                  esp_err_to_name(err_status));
@@ -430,6 +928,27 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
     }
 }
 
+void zigbee_get_callback_stats(zigbee_cb_stats_t *out)
+{
+    *out = attr_cb_stats;
+}
+
+esp_err_t zigbee_send_status_handler_add(esp_zb_zcl_command_send_status_callback_t cb)
+{
+    for (size_t i = 0; i < SEND_STATUS_HANDLERS; i++) {
+        if (send_status_handlers[i] == NULL || send_status_handlers[i] == cb) {
+            send_status_handlers[i] = cb;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void zigbee_get_send_stats(zigbee_send_stats_t *out)
+{
+    *out = send_stats;
+}
+
 bool zigbee_is_connected(void)
 {
     return esp_zb_bdb_dev_joined();
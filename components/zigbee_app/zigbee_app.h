@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include "sdkconfig.h"
 #include "esp_err.h"
 #include "esp_zigbee_core.h"
 
@@ -8,16 +9,60 @@
 #define INSTALLCODE_POLICY_ENABLE       false   /* enable the install code policy for security */
 #define ED_AGING_TIMEOUT                ESP_ZB_ED_AGING_TIMEOUT_64MIN
 #define ED_KEEP_ALIVE                   3000    /* 3000 millisecond */
+
+/* Device role and table sizes come from menuconfig ("Lamp Zigbee profile"). The role defaults to
+ * end device, as before; a router build needs CONFIG_ZB_ZCZR. Changing the role of a commissioned
+ * lamp needs a factory reset and re-pair. */
+#ifdef CONFIG_LAMP_ZB_ROLE_ROUTER
+#define LAMP_ROUTER_ROLE                1
+#define LAMP_MAX_CHILDREN               CONFIG_LAMP_ZB_MAX_CHILDREN     /* end devices a lamp will parent */
+#define LAMP_PERMIT_JOIN_S              CONFIG_LAMP_ZB_PERMIT_JOIN_S    /* open the network after joining; 0 = only when asked */
+#else
+#define LAMP_ROUTER_ROLE                0
+#define LAMP_MAX_CHILDREN               0
+#define LAMP_PERMIT_JOIN_S              0
+#endif
+
+/* Stack table-size presets, applied before esp_zb_init(). The overall network size scales the
+ * neighbour, routing, address map, source route and APS key tables, about 62 bytes per entry;
+ * a binding costs 16 (source) and about 24 (destination) bytes. Figures are those table entries
+ * only, from the ZBOSS struct sizes for a 32-bit target, not a measurement on the C6: the heap
+ * the stack really takes, fixed part included, is logged at start-up ("Zigbee stack heap").
+ *   SMALL   network  32, bindings  8/8    tables ~2.3 KB
+ *   MEDIUM  network  64, bindings 16/16   tables ~4.5 KB   (stack defaults)
+ *   LARGE   network 128, bindings 32/32   tables ~9.0 KB */
+#define LAMP_TABLES_SMALL               0
+#define LAMP_TABLES_MEDIUM              1
+#define LAMP_TABLES_LARGE               2
+#if defined(CONFIG_LAMP_ZB_TABLES_SMALL)
+#define LAMP_TABLES_PRESET              LAMP_TABLES_SMALL
+#elif defined(CONFIG_LAMP_ZB_TABLES_LARGE)
+#define LAMP_TABLES_PRESET              LAMP_TABLES_LARGE
+#else
+#define LAMP_TABLES_PRESET              LAMP_TABLES_MEDIUM
+#endif
+
 #define HA_COLOR_DIMMABLE_LIGHT_ENDPOINT  10                                    /* esp light switch device endpoint */
 #define ESP_ZB_PRIMARY_CHANNEL_MASK     ESP_ZB_TRANSCEIVER_ALL_CHANNELS_MASK    /* Zigbee primary channel mask use in the example */
+#define LIGHT_TRANSITION_MS             400     /* fade applied to level / colour temperature changes */
 
 #define TEMP_SENSOR_UPDATE_INTERVAL (1)     /* Local sensor update interval (second) */
 #define TEMP_SENSOR_MIN_VALUE       (-10)   /* Local sensor min measured value (degree Celsius) */
 #define TEMP_SENSOR_MAX_VALUE       (80)    /* Local sensor max measured value (degree Celsius) */
+#define TEMP_REPORT_MIN_S           10      /* no temperature report more often than this */
+#define TEMP_REPORT_MAX_S           300     /* heartbeat report even without change */
+#define TEMP_REPORT_DELTA           50      /* reportable change, centi-degrees (TC74 steps are 1 degree) */
+#define PRESSURE_REPORT_MIN_S       30      /* no pressure report more often than this */
+#define PRESSURE_REPORT_MAX_S       600     /* heartbeat report even without change */
+#define PRESSURE_REPORT_DELTA       1       /* reportable change, hPa (MeasuredValue units) */
+#define SENSOR_PUBLISH_MS           2000    /* sensor table -> measurement attributes */
+#define SENSOR_STALE_MS             10000   /* older sensor values are not published */
 
 // Zigbee attribute IDs
 #define ATTRID_LEVEL_AMBER  0xF001
 #define ATTRID_LEVEL_WHITE  0xF002
+#define ATTRID_BOOT_TRACE   0xF010  // Basic cluster, manufacturer specific: boot timeline (read only)
+#define ZB_MANUFACTURER_CODE 0x131B // Espressif
 
 /* Attribute values in ZCL string format
  * The string should be started with the length of its own.
@@ -36,6 +81,21 @@ void esp_zb_task(void *pvParameters);
         },                                                          \
     }
 
+#define ESP_ZB_ZR_CONFIG()                                          \
+    {                                                               \
+        .esp_zb_role = ESP_ZB_DEVICE_TYPE_ROUTER,                   \
+        .install_code_policy = INSTALLCODE_POLICY_ENABLE,           \
+        .nwk_cfg.zczr_cfg = {                                       \
+            .max_children = LAMP_MAX_CHILDREN,                      \
+        },                                                          \
+    }
+
+#if LAMP_ROUTER_ROLE
+#define ESP_ZB_LAMP_CONFIG()            ESP_ZB_ZR_CONFIG()
+#else
+#define ESP_ZB_LAMP_CONFIG()            ESP_ZB_ZED_CONFIG()
+#endif
+
 #define ESP_ZB_DEFAULT_RADIO_CONFIG()                           \
     {                                                           \
         .radio_mode = ZB_RADIO_MODE_NATIVE,                     \
@@ -46,12 +106,57 @@ void esp_zb_task(void *pvParameters);
         .host_connection_mode = ZB_HOST_CONNECTION_MODE_NONE,   \
     }
 
+// Execution time of the attribute callback inside the Zigbee task
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t total_us;
+} zigbee_cb_stats_t;
+
+// Power-on behaviour, set through the ZCL StartUp* attributes and persisted with the light state
+#define LIGHT_STARTUP_OFF             0x00
+#define LIGHT_STARTUP_ON              0x01
+#define LIGHT_STARTUP_TOGGLE          0x02
+#define LIGHT_STARTUP_PREVIOUS        0xFF
+#define LIGHT_STARTUP_MIRED_PREVIOUS  0xFFFF
+
+typedef struct {
+    uint8_t on_off;    // StartUpOnOff: LIGHT_STARTUP_*
+    uint8_t level;     // StartUpCurrentLevel: 0 = minimum, 0xFF = previous
+    uint16_t mired;    // StartUpColorTemperatureMireds: LIGHT_STARTUP_MIRED_PREVIOUS = previous
+} light_startup_t;
+
+// ZCL frames the stack reported as sent or failed, automatic and one-shot reports included
+typedef struct {
+    uint32_t sent;
+    uint32_t failed;
+} zigbee_send_stats_t;
+
 bool zigbee_is_connected(void);
-void LoadFromNVS();
+void zigbee_get_callback_stats(zigbee_cb_stats_t *out);
+void zigbee_get_send_stats(zigbee_send_stats_t *out);
+// The stack calls one send-status callback; modules that need the outcome of their frames add a
+// handler here and all of them see every status. From the Zigbee task. ESP_ERR_NO_MEM when full.
+esp_err_t zigbee_send_status_handler_add(esp_zb_zcl_command_send_status_callback_t cb);
+// Restores the persisted state with the startup behaviour applied. Returns false if nothing was
+// stored yet (factory-new lamp) and defaults are used.
+bool LoadFromNVS();
 extern int32_t current_brightness;  
 extern int32_t mired;
-void SaveToNVS(); 
-void zigbee_update_temperature(float temperature);
+extern bool light_on;
+extern light_startup_t light_startup;
+
+// The persisted light state as one consistent copy. The attribute handler changes the globals
+// above under a lock in the Zigbee task; other tasks read them only through light_state_snapshot().
+typedef struct {
+    int32_t level;
+    int32_t mired;
+    bool on;
+    light_startup_t startup;
+} light_state_t;
+
+void light_state_snapshot(light_state_t *out);
+void SaveToNVS(const light_state_t *state);
 
 static esp_err_t zb_cmd_received_handler(const esp_zb_zcl_cmd_info_t *info);
    
@@ -1,122 +1,114 @@
 #include "driver/i2c_master.h"
 #include "tlc59108.h"
+#include "led_fade.h"
 #include "tc74.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "boot_trace.h"
 #include "zigbee_app.h"
+#include "light_store.h"
+#include "zb_rejoin.h"
+#include "state_journal.h"
 #include "esp_zigbee_core.h"
 #include "esp_check.h"
 #include "ha/esp_zigbee_ha_standard.h"
 #include "nvs_flash.h"
 #include "ms8607.h"
+#include "sensor_sched.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 static const char *TAG = "MAIN";
 
-// I2C Scanner function
-void scan_i2c(i2c_master_bus_handle_t bus)
-{
-    ESP_LOGI(TAG, "Starting I2C scan...");
+// The boot animation, the join sequence and the breathing waveform all run on this stack
+#define LED_TASK_STACK 4096
 
-    for (int addr = 1; addr < 127; addr++) {
-        esp_err_t ret = i2c_master_probe(bus, addr, 50);  // timeout = 50us
-        if (ret == ESP_OK) {
-            ESP_LOGI(TAG, "✔ Found device at address: 0x%02X", addr);
-        }
-    }
-    ESP_LOGI(TAG, "I2C scan finished.");
+// Commissioned lamp with a persisted light state: skip the animations
+static bool fast_restore = false;
+
+static void led_refresh_cb(void *arg)
+{
+    xTaskNotifyGive((TaskHandle_t)arg);
 }
 
+// LED render task: once running it is the only context that talks to the TLC59108.
+// The Zigbee task hands over targets through the mailbox.
 void led_task(void *arg)
 {
-    const TickType_t loop_delay = pdMS_TO_TICKS(30);
     bool connection_confirmed = false;
-    //bool connected = false;
-    int32_t counter = 0;
+    uint32_t dither_ticks = 0;
+    led_target_t target;
+    uint32_t frames = 0;
+    UBaseType_t stack_low = LED_TASK_STACK;
+
+    // Factory-new lamp: boot animation runs here instead of holding up app_main
+    if (!fast_restore) {
+        led_boot_trail_spin_animation();
+        boot_trace_mark(BOOT_ANIMATION_DONE);
+    }
+
+    // Woken at the dither refresh rate, faster than the FreeRTOS tick allows; fades and the
+    // mailbox run at the frame rate, the ticks in between only advance the dither. With no
+    // fraction left to dither the timer stops and frames come from the FreeRTOS tick instead.
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    const esp_timer_create_args_t refresh_args = {
+        .callback = led_refresh_cb,
+        .arg = self,
+        .name = "led_refresh",
+    };
+    esp_timer_handle_t refresh_timer;
+    ESP_ERROR_CHECK(esp_timer_create(&refresh_args, &refresh_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(refresh_timer, TLC_DITHER_PERIOD_US));
+    bool refresh_running = true;
+
     while (1) {
-        counter++;
-        //if (!connected) {
-        if (!zigbee_is_connected()) {
-            tlc_breathe_update(0.03f);
+        ulTaskNotifyTake(pdTRUE, refresh_running ? portMAX_DELAY : pdMS_TO_TICKS(LED_FADE_FRAME_MS));
+        if (refresh_running && ++dither_ticks < LED_FADE_DITHER_TICKS) {
+            if (fast_restore || connection_confirmed) tlc_dither_tick();
+            continue;
+        }
+        dither_ticks = 0;
+        // A restored lamp shows its state and takes commands from power-on; a factory-new
+        // one waits for the join and plays the confirmation sequence first
+        if (!fast_restore && !zigbee_is_connected()) {
+            tlc_breathe_update(LED_FADE_FRAME_MS / 1000.0f);
         }
         else {
-            if (!connection_confirmed) {
+            if (!connection_confirmed && !fast_restore) {
                 connection_confirmed = true;
                 zigbee_connection_confirmed_sequence();
+                led_fade_refresh();   // bring back the light state the sequence blanked
             }
-        }
-        //if (counter >= 33*10 && !connected) { // approx every second
-        //    ESP_LOGI(TAG, "Fake connection done");
-        //    connected = true;
-        //}
-        vTaskDelay(loop_delay);
-    }
-}
-
-
-
-void temperature_task_old_men_funke(void *arg) {
-    const TickType_t temp_delay = pdMS_TO_TICKS(2000);
-    float t_ms;
-    float rh;
-    while (1) {
-        float t = -1.0f; 
-        esp_err_t ret = tc74_read_temperature(&t);
-        
-
-        if (ret == ESP_OK) {
-            ESP_LOGI(TAG, "Temp = %.1f °C", t);
-            if (zigbee_is_connected()) {
-                zigbee_update_temperature(t);
+            // Bursts of Zigbee commands collapse to the newest target here
+            if (led_mailbox_take(&target)) {
+                led_fade_apply_target(&target);
+            }
+            // A fade frame already advanced the dither
+            if (!led_fade_tick()) {
+                tlc_dither_tick();
             }
-        } else {
-            ESP_LOGE(TAG, "I2C Read Failed: %s", esp_err_to_name(ret));
         }
-        vTaskDelay(temp_delay);
-    }
-}
-
-void temperature_task(void *arg) {
-    const TickType_t temp_delay = pdMS_TO_TICKS(2000);
 
-    while (1) {
-        float t_tc74 = -1.0f;
-        float t_ms   = -1.0f;
-        float rh     = -1.0f;
-
-        esp_err_t ret_tc74 = tc74_read_temperature(&t_tc74);
-        esp_err_t ret_ms   = ms8607_read_temperature_humidity(&t_ms, &rh);
-
-        // Log all values in one line (with error info if something failed)
-        if (ret_tc74 == ESP_OK && ret_ms == ESP_OK) {
-            ESP_LOGI(TAG, "TC74: %.1f °C | MS8607: %.2f °C, %.1f %%RH",
-                     t_tc74, t_ms, rh);
-        } else {
-            ESP_LOGI(TAG, "TC74: %s (%.1f °C) | MS8607: %s (%.2f °C, %.1f %%RH)",
-                     esp_err_to_name(ret_tc74), t_tc74,
-                     esp_err_to_name(ret_ms),   t_ms, rh);
-
-            if (ret_tc74 != ESP_OK) {
-                ESP_LOGE(TAG, "TC74 read failed: %s", esp_err_to_name(ret_tc74));
-            }
-            if (ret_ms != ESP_OK) {
-                ESP_LOGE(TAG, "MS8607 read failed: %s", esp_err_to_name(ret_ms));
+        bool dither_needed = (fast_restore || connection_confirmed) && tlc_dither_active();
+        if (dither_needed != refresh_running) {
+            if (dither_needed) {
+                ESP_ERROR_CHECK(esp_timer_start_periodic(refresh_timer, TLC_DITHER_PERIOD_US));
+            } else {
+                ESP_ERROR_CHECK(esp_timer_stop(refresh_timer));
             }
+            refresh_running = dither_needed;
+            dither_ticks = 0;
         }
 
-        // Zigbee updates (only send what is valid)
-        if (zigbee_is_connected()) {
-            if (ret_tc74 == ESP_OK) {
-                zigbee_update_temperature(t_tc74);
+        // Once a second: log the stack use whenever it reaches a new high
+        if (++frames % LED_FADE_FRAME_HZ == 0) {
+            UBaseType_t unused = uxTaskGetStackHighWaterMark(NULL);
+            if (unused < stack_low) {
+                stack_low = unused;
+                ESP_LOGI(TAG, "led_task stack: %u of %u bytes never used", (unsigned)unused, LED_TASK_STACK);
             }
-
-            // If you add these Zigbee endpoints/clusters later:
-            // if (ret_ms == ESP_OK) zigbee_update_temperature_ms8607(t_ms);
-            // if (ret_ms == ESP_OK) zigbee_update_humidity(rh);
         }
-
-        vTaskDelay(temp_delay);
     }
 }
 
@@ -124,6 +116,8 @@ void temperature_task(void *arg) {
 
 void app_main(void)
 {
+    boot_trace_mark(BOOT_APP_START);
+
     // Initiate i2c bus
     i2c_master_bus_config_t bus_cfg = {
         .clk_source = I2C_CLK_SRC_DEFAULT,
@@ -136,56 +130,60 @@ void app_main(void)
 
     i2c_master_bus_handle_t bus;
     ESP_ERROR_CHECK(i2c_new_master_bus(&bus_cfg, &bus));
-    scan_i2c(bus);
-    // Initialize temperature sensor
-    tc74_init(bus);
-    ESP_ERROR_CHECK(ms8607_init(bus));
-    vTaskDelay(pdMS_TO_TICKS(300)); // initial delay to allow Zigbee to connect first
-    // Initiate LED driver
+    boot_trace_mark(BOOT_I2C_READY);
+
+    // Initiate LED driver first: after a wall-switch power cycle the lamp should light
+    // before anything else runs
     tlc_reset_init();
     tlc59108_init(bus);
     tlc_power_set(true);   
     //tlc_dump_registers();
-    tlc_reset_init();
-    led_boot_trail_spin_animation();
+
+    ESP_LOGI("MAIN", "Starting NVS flash init");
+    ESP_ERROR_CHECK(nvs_flash_init());
+    state_journal_init(); // Falls back to NVS when the partition table has no journal
+    boot_trace_mark(BOOT_NVS_READY);
+
+    // Last known state with the ZCL StartUp* behaviour applied
+    bool state_loaded = LoadFromNVS();
+    light_store_start(state_loaded); // Debounced write-behind of later changes
+    // The network the stack joined last; a light state alone survives leave and reset
+    zb_rejoin_init();
+    fast_restore = state_loaded && zb_rejoin_has_network();
+    boot_trace_mark(BOOT_STATE_LOADED);
+
+    if (fast_restore) {
+        // Commissioned lamp: straight to the restored light, no animations
+        led_fade_init(light_on ? (uint8_t)current_brightness : 0, (uint16_t)mired);
+        led_fade_tick();
+        boot_trace_mark(BOOT_LIGHT_ON);
+        // esp_timer starts with the app; ROM and bootloader time come on top
+        ESP_LOGI(TAG, "Power-on to light: %lld us after app start", (long long)esp_timer_get_time());
+    }
 
     // Start breathing to indicate "not yet joined"
     //tlc_breathe_init(0.2f);  // 0.25 Hz = slow breathing
 
-
-    scan_i2c(bus);
-
-    const float dt = 0.01f;  // 10 ms tick
-    
     esp_zb_platform_config_t config = {
         .radio_config = ESP_ZB_DEFAULT_RADIO_CONFIG(),
         .host_config = ESP_ZB_DEFAULT_HOST_CONFIG(),
     };
-    ESP_LOGI("MAIN", "Starting NVS flash init");
-    ESP_ERROR_CHECK(nvs_flash_init());
-
-    LoadFromNVS(); // Loading last known brightness / color temperature
 
     ESP_LOGI("MAIN", "Starting ESP Zigbee Config");
     ESP_ERROR_CHECK(esp_zb_platform_config(&config));
+    boot_trace_mark(BOOT_ZB_PLATFORM);
 
-    /* Start Zigbee stack task */
+    // The network comes first; everything else runs beside the join in its own task
     ESP_LOGI("MAIN", "Starting ESP Zigbee Task");
     xTaskCreate(esp_zb_task, "Zigbee_main", 4096, NULL, 5, NULL);
     
     /* Start LED task */
-    xTaskCreate(led_task,"led_task",2048,NULL,5,NULL);
-
-    /* Start Temp Sensor task */
-    xTaskCreate(temperature_task,"temperature_task",4096,NULL,4,NULL);
+    xTaskCreate(led_task,"led_task",LED_TASK_STACK,NULL,5,NULL);
 
-    vTaskDelay(pdMS_TO_TICKS(400)); // Wait for tasks to settle
+    /* Sensors share one scheduler task, which also brings them up */
+    ESP_ERROR_CHECK(tc74_sensor_register(bus));
+    ESP_ERROR_CHECK(ms8607_sensor_register(bus));
+    ESP_ERROR_CHECK(sensor_sched_start());
 
-    while (1) {
-        //float t;
-        //if (tc74_read_temperature(&t) == ESP_OK) {
-        //    ESP_LOGI(TAG, "while loop Temp = %.1f °C", t);
-        //    }
-        vTaskDelay(pdMS_TO_TICKS(100)); // yield so IDLE resets WDT
-    }
+    // app_main returns here; its task is deleted and the scheduler carries on
 }
@@ -0,0 +1,129 @@
+// Benchmark of the MS8607 compensation (ms8607.c) on the host: the integer path against the
+// same formulas in double precision, which the C6 (no FPU) would run as libgcc soft-float calls.
+// Timings are for comparison on this machine; only the correctness checks can fail.
+#include "host_test.h"
+#include "ms8607.h"
+#include "boot_trace.h"
+#include "sensor_sched.h"
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+void boot_trace_mark(boot_phase_t phase) {}
+esp_err_t sensor_register(const sensor_driver_t *driver) { return ESP_OK; }
+void sensor_publish(sensor_value_id_t id, int32_t value) {}
+
+// Datasheet example coefficients C1..C6
+static const uint16_t datasheet_c[8] = {0, 46372, 43981, 29059, 27842, 31553, 28165, 0};
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint64_t now_cycles(void)
+{
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static volatile int32_t sink;
+
+// The datasheet formulas in double precision
+static void double_compensate(const uint16_t *c, uint32_t d1, uint32_t d2, int32_t *temperature, int32_t *pressure)
+{
+    double dT = (double)d2 - c[5] * 256.0;
+    double temp = 2000 + dT * c[6] / 8388608.0;
+    double off = c[2] * 131072.0 + c[4] * dT / 64.0;
+    double sens = c[1] * 65536.0 + c[3] * dT / 128.0;
+    double t2 = 5 * dT * dT / 274877906944.0, off2 = 0, sens2 = 0;
+    if (temp < 2000) {
+        double low = (temp - 2000) * (temp - 2000);
+        t2 = 3 * dT * dT / 8589934592.0;
+        off2 = 61 * low / 16;
+        sens2 = 29 * low / 16;
+        if (temp < -1500) {
+            off2 += 17 * (temp + 1500) * (temp + 1500);
+            sens2 += 9 * (temp + 1500) * (temp + 1500);
+        }
+    }
+    *temperature = (int32_t)(temp - t2);
+    *pressure = (int32_t)((d1 * (sens - sens2) / 2097152.0 - (off - off2)) / 32768.0);
+}
+
+#define INPUTS 1024
+#define ROUNDS 2000
+
+static uint32_t d1s[INPUTS], d2s[INPUTS];
+
+// Raw values from about -30 C to +60 C and 300 to 1100 mbar, both compensation branches
+static void make_inputs(void)
+{
+    for (int i = 0; i < INPUTS; i++) {
+        d2s[i] = 7000000 + (uint32_t)i * 1500;
+        d1s[i] = 5000000 + (uint32_t)(i * 7919 % INPUTS) * 1600;
+    }
+}
+
+typedef void (*compensate_fn)(const uint16_t *, uint32_t, uint32_t, int32_t *, int32_t *);
+
+// ns and, where the host has a cycle counter, cycles per call
+static void time_compensation(compensate_fn fn, double *ns, double *cycles)
+{
+    double t0 = now_ns();
+    uint64_t c0 = now_cycles();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; i < INPUTS; i++) {
+            int32_t t, p;
+            fn(datasheet_c, d1s[i], d2s[i], &t, &p);
+            sink += t + p;
+        }
+    }
+    *cycles = (double)(now_cycles() - c0) / (ROUNDS * INPUTS);
+    *ns = (now_ns() - t0) / (ROUNDS * INPUTS);
+}
+
+static void bench_compensation(void)
+{
+    int32_t t, p;
+    ms8607_compensate_pt(datasheet_c, 6465444, 8077636, &t, &p);
+    CHECK_EQ(t, 2000);
+    CHECK_EQ(p, 110002);
+
+    // The integer path stays within 2 LSB of the floating-point formulas over the whole range
+    make_inputs();
+    int worst = 0;
+    for (int i = 0; i < INPUTS; i++) {
+        int32_t ti, pi, tf, pf;
+        ms8607_compensate_pt(datasheet_c, d1s[i], d2s[i], &ti, &pi);
+        double_compensate(datasheet_c, d1s[i], d2s[i], &tf, &pf);
+        int dt = ti > tf ? ti - tf : tf - ti, dp = pi > pf ? pi - pf : pf - pi;
+        if (dt > worst) worst = dt;
+        if (dp > worst) worst = dp;
+    }
+    CHECK(worst <= 2);
+
+    double int_ns, int_cycles, double_ns, double_cycles;
+    time_compensation(ms8607_compensate_pt, &int_ns, &int_cycles);
+    time_compensation(double_compensate, &double_ns, &double_cycles);
+    printf("ms8607_compensate_pt: integer %.1f ns, double %.1f ns per call on this host", int_ns, double_ns);
+#ifdef HAVE_TSC
+    printf(" (%.0f / %.0f TSC cycles)", int_cycles, double_cycles);
+#endif
+    printf("; worst difference %d LSB\n", worst);
+    printf("on the C6 the first sample logs the count from esp_cpu_get_cycle_count(), see "
+           "ms8607_stats_t.compensate_cycles\n");
+}
+
+int main(void)
+{
+    bench_compensation();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,198 @@
+// Benchmarks of the TLC59108 light pipeline (tlc59108.c) on the host. Timings are printed for
+// comparison between code paths on the same machine; only the correctness checks can fail.
+#include "host_test.h"
+#include "host_fakes.h"
+#include "tlc59108.h"
+#include "tlc59108_tables.h"
+#include "boot_trace.h"
+#include <math.h>
+#include <time.h>
+
+void boot_trace_mark(boot_phase_t phase) {}
+
+#define TLC_ADDR 0x41
+#define REG_PWM0 0x02
+
+static uint8_t chip_regs[0x12];
+
+static esp_err_t fake_tlc_write(host_i2c_device_t *dev, const uint8_t *data, size_t len)
+{
+    uint8_t reg = data[0] & 0x1F;
+    for (size_t i = 1; i < len; i++, reg = (reg + 1) % sizeof(chip_regs)) chip_regs[reg] = data[i];
+    return ESP_OK;
+}
+
+static host_i2c_device_t chip = {.address = TLC_ADDR, .write = fake_tlc_write};
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static volatile uint32_t sink;
+
+// CT mixer before the Q15 table: soft-float on the C6, which has no FPU
+static void float_mix(float brightness, uint16_t mired, uint16_t *amber_pwm, uint16_t *white_pwm)
+{
+    float kelvin = 1000000.0f / (float)mired;
+    if (kelvin < 2200.0f) kelvin = 2200.0f;
+    if (kelvin > 5000.0f) kelvin = 5000.0f;
+    float white = (kelvin - 2200.0f) / (5000.0f - 2200.0f);
+    if (white < 0) white = 0;
+    if (white > 1) white = 1;
+    float amber = 1.0f - white;
+    *amber_pwm = (uint16_t)(brightness * amber);
+    *white_pwm = (uint16_t)(brightness * white);
+}
+
+// The integer steps led_apply_level_q8_and_ct() takes: table lookups and two Q15 multiplies
+static void fixed_mix(uint16_t level, uint16_t mired, uint16_t *amber, uint16_t *white)
+{
+    if (mired < CT_MIRED_MIN) mired = CT_MIRED_MIN;
+    if (mired > CT_MIRED_MAX) mired = CT_MIRED_MAX;
+    uint16_t white_share = ct_white_q15[mired - CT_MIRED_MIN];
+    uint16_t intensity = level_linear_u16[level];
+    *white = (uint16_t)(((uint32_t)intensity * white_share) >> 15);
+    *amber = (uint16_t)(((uint32_t)intensity * (CT_Q15_ONE - white_share)) >> 15);
+}
+
+// user-005: the driver's output against the float mixer, every level and mired
+static void golden_ct_mix(void)
+{
+    tlc_set_level_curve(TLC_CURVE_LINEAR);
+    tlc_set_group_alloc(TLC_ALLOC_UNIFORM);
+    tlc_set_dither_enabled(false);
+
+    int worst = 0;
+    for (uint16_t level = 0; level <= LEVEL_MAX; level++) {
+        for (uint16_t mired = 150; mired <= 500; mired++) {
+            led_apply_level_q8_and_ct(level << 8, mired);
+
+            // The old path wrote the level straight into PWMx, so it topped out at 254/256 duty;
+            // the table path maps LEVEL_MAX to full duty (256 counts, saturating at 255) and
+            // rounds where the float path truncated. Compare on the same scale.
+            uint16_t amber, white;
+            float_mix(level * 256.0f / LEVEL_MAX, mired, &amber, &white);
+            int da = chip_regs[REG_PWM0 + 0] - (amber > 0xFF ? 0xFF : amber);
+            int dw = chip_regs[REG_PWM0 + 3] - (white > 0xFF ? 0xFF : white);
+            if (da < 0) da = -da;
+            if (dw < 0) dw = -dw;
+            if (da > worst) worst = da;
+            if (dw > worst) worst = dw;
+        }
+    }
+    printf("CT mix: worst difference to the float mixer %d LSB\n", worst);
+    CHECK(worst <= 1);
+
+    tlc_set_level_curve(TLC_DEFAULT_LEVEL_CURVE);
+    tlc_set_group_alloc(TLC_DEFAULT_GROUP_ALLOC);
+    tlc_set_dither_enabled(true);
+}
+
+#define MIX_ROUNDS 200
+
+static void bench_ct_mix(void)
+{
+    double t0 = now_ns();
+    for (int round = 0; round < MIX_ROUNDS; round++) {
+        for (uint16_t mired = 150; mired <= 500; mired++) {
+            uint16_t amber, white;
+            float_mix((float)(mired & 0xFF), mired, &amber, &white);
+            sink += amber + white;
+        }
+    }
+    double t1 = now_ns();
+    for (int round = 0; round < MIX_ROUNDS; round++) {
+        for (uint16_t mired = 150; mired <= 500; mired++) {
+            uint16_t amber, white;
+            fixed_mix((uint16_t)(mired % (LEVEL_MAX + 1)), mired, &amber, &white);
+            sink += amber + white;
+        }
+    }
+    double t2 = now_ns();
+
+    double n = MIX_ROUNDS * (500 - 150 + 1);
+    // Per mix: float does 1 int->float, 2 divides, 3 adds/subtracts, 2 multiplies, 2 float->int,
+    // each a libgcc call on the C6; fixed does 2 loads, 2 integer multiplies and shifts
+    printf("CT mix: float %.2f ns, fixed %.2f ns per call on this host (10 float ops vs 0)\n",
+           (t1 - t0) / n, (t2 - t1) / n);
+}
+
+// CIE 1931 lightness evaluated per call, what the table replaces
+static uint16_t cie1931_direct(uint16_t level)
+{
+    float lightness = 100.0f * level / LEVEL_MAX;
+    float y = lightness <= 8.0f ? lightness / 903.3f : powf((lightness + 16.0f) / 116.0f, 3.0f);
+    return (uint16_t)(y * INTENSITY_MAX + 0.5f);
+}
+
+#define LOOKUP_ROUNDS 2000
+
+// user-006: tlc_level_to_intensity() is one table load; the formula costs a powf() per call
+static void bench_level_lookup(void)
+{
+    tlc_set_level_curve(TLC_CURVE_CIE1931);
+    int worst = 0;
+    for (uint16_t level = 0; level <= LEVEL_MAX; level++) {
+        int diff = tlc_level_to_intensity(level) - cie1931_direct(level);
+        if (diff < 0) diff = -diff;
+        if (diff > worst) worst = diff;
+    }
+    CHECK(worst <= 2);   // float vs the generator's double precision
+
+    double t0 = now_ns();
+    for (int round = 0; round < LOOKUP_ROUNDS; round++) {
+        for (uint16_t level = 0; level <= LEVEL_MAX; level++) sink += cie1931_direct(level);
+    }
+    double t1 = now_ns();
+    for (int round = 0; round < LOOKUP_ROUNDS; round++) {
+        for (uint16_t level = 0; level <= LEVEL_MAX; level++) sink += tlc_level_to_intensity(level);
+    }
+    double t2 = now_ns();
+
+    double n = LOOKUP_ROUNDS * (LEVEL_MAX + 1);
+    printf("level curve: formula %.2f ns, lookup %.2f ns per level on this host\n",
+           (t1 - t0) / n, (t2 - t1) / n);
+    tlc_set_level_curve(TLC_DEFAULT_LEVEL_CURVE);
+}
+
+#define APPLY_ROUNDS 200
+
+static double time_apply(tlc_group_alloc_t alloc)
+{
+    tlc_set_group_alloc(alloc);
+    double t0 = now_ns();
+    for (int round = 0; round < APPLY_ROUNDS; round++) {
+        for (uint32_t level_q8 = 0; level_q8 <= LEVEL_MAX << 8; level_q8 += 61) {
+            led_apply_level_q8_and_ct((uint16_t)level_q8, 300);
+        }
+    }
+    return (now_ns() - t0) / (APPLY_ROUNDS * ((LEVEL_MAX << 8) / 61 + 1));
+}
+
+// user-008: cost of spreading a group total over its LEDs against giving them one value; the
+// frame includes the dither render and the flush to the fake bus, which both modes share
+static void bench_group_alloc(void)
+{
+    tlc_set_dither_enabled(false);
+    double uniform = time_apply(TLC_ALLOC_UNIFORM);
+    double spread = time_apply(TLC_ALLOC_SPREAD);
+    printf("led_apply_level_q8_and_ct: uniform %.1f ns, spread %.1f ns per frame on this host\n",
+           uniform, spread);
+    tlc_set_group_alloc(TLC_DEFAULT_GROUP_ALLOC);
+    tlc_set_dither_enabled(true);
+}
+
+int main(void)
+{
+    host_i2c_attach(&chip);
+    CHECK_EQ(tlc59108_init(NULL), ESP_OK);
+
+    golden_ct_mix();
+    bench_ct_mix();
+    bench_level_lookup();
+    bench_group_alloc();
+    return HOST_TEST_RESULT();
+}
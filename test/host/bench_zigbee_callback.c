@@ -0,0 +1,142 @@
+// user-010: the Zigbee attribute callback (zigbee_app.c) fed 1000 synthetic set-attribute
+// messages, as a hub sends them during slider drags. The callback must leave the LED bus alone
+// and hand the newest light state to the render task through the mailbox.
+#include "host_test.h"
+#include "host_fakes.h"
+#include "host_zigbee.h"
+#include "zigbee_app.h"
+#include "light_store.h"
+#include "led_mailbox.h"
+#include "driver/i2c_master.h"
+#include "freertos/task.h"
+#include <time.h>
+
+#define MESSAGES        1000
+#define MESSAGE_GAP_US  20000   // a slider drag sends about 50 updates per second
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static esp_err_t fake_tlc_write(host_i2c_device_t *dev, const uint8_t *data, size_t len)
+{
+    return ESP_OK;
+}
+
+static host_i2c_device_t chip = {.address = 0x41, .write = fake_tlc_write};
+
+// Bus time the callback spent before the mailbox: six single-register PWM writes per message,
+// replayed on the fake 100 kHz bus
+static int64_t legacy_callback_bus_us(void)
+{
+    i2c_master_dev_handle_t dev;
+    i2c_device_config_t cfg = {.device_address = chip.address, .scl_speed_hz = 100000};
+    i2c_master_bus_add_device(NULL, &cfg, &dev);
+    host_i2c_attach(&chip);
+
+    int64_t busy = host_i2c_busy_us;
+    for (uint8_t reg = 0x02; reg < 0x08; reg++) {
+        uint8_t frame[2] = {reg, 0x80};
+        i2c_master_transmit(dev, frame, sizeof(frame), -1);
+    }
+    return host_i2c_busy_us - busy;
+}
+
+// The message for update n: level and colour temperature sweeps, switched off and on now and then
+static void synthetic_message(int n, esp_zb_zcl_set_attr_value_message_t *msg, uint8_t *u8, uint16_t *u16,
+                              bool *on)
+{
+    msg->info.status = ESP_ZB_ZCL_STATUS_SUCCESS;
+    msg->info.dst_endpoint = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT;
+    switch (n % 3) {
+    case 0:
+        *u8 = (uint8_t)(1 + n % 254);
+        msg->info.cluster = ESP_ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL;
+        msg->attribute.id = ESP_ZB_ZCL_ATTR_LEVEL_CONTROL_CURRENT_LEVEL_ID;
+        msg->attribute.data = (esp_zb_zcl_attribute_data_t){ESP_ZB_ZCL_ATTR_TYPE_U8, 1, u8};
+        break;
+    case 1:
+        *u16 = (uint16_t)(200 + n % 256);
+        msg->info.cluster = ESP_ZB_ZCL_CLUSTER_ID_COLOR_CONTROL;
+        msg->attribute.id = ESP_ZB_ZCL_ATTR_COLOR_CONTROL_COLOR_TEMPERATURE_ID;
+        msg->attribute.data = (esp_zb_zcl_attribute_data_t){ESP_ZB_ZCL_ATTR_TYPE_U16, 2, u16};
+        break;
+    default:
+        *on = n % 100 != 2;
+        msg->info.cluster = ESP_ZB_ZCL_CLUSTER_ID_ON_OFF;
+        msg->attribute.id = ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID;
+        msg->attribute.data = (esp_zb_zcl_attribute_data_t){ESP_ZB_ZCL_ATTR_TYPE_BOOL, 1, on};
+        break;
+    }
+}
+
+static void bench_attribute_callback(void)
+{
+    // Start-up as app_main() does it, minus the LED render task: the mailbox is read here
+    light_store_start(false);
+    xTaskCreate(esp_zb_task, "Zigbee_main", 4096, NULL, 5, NULL);
+    host_task_run(host_time_us);
+
+    uint32_t bus_transactions = host_i2c_transactions;
+    double total_ns = 0, max_ns = 0;
+    uint8_t u8 = 0;
+    uint16_t u16 = 0;
+    bool on = true;
+    int published = 0;
+    uint32_t changes = 0;
+    led_target_t target = {0};
+
+    for (int n = 0; n < MESSAGES; n++) {
+        esp_zb_zcl_set_attr_value_message_t msg = {0};
+        synthetic_message(n, &msg, &u8, &u16, &on);
+
+        int32_t was_level = current_brightness, was_mired = mired;
+        bool was_on = light_on;
+        double t0 = now_ns();
+        CHECK_EQ(host_zb_action(ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID, &msg), ESP_OK);
+        double elapsed = now_ns() - t0;
+        if (current_brightness != was_level || mired != was_mired || light_on != was_on) changes++;
+        total_ns += elapsed;
+        if (elapsed > max_ns) max_ns = elapsed;
+
+        // The render task takes a target every other message (100 Hz frames, 50 Hz updates)
+        if (n % 2 == 1 && led_mailbox_take(&target)) published++;
+        host_task_run(host_time_us + MESSAGE_GAP_US);
+    }
+    if (led_mailbox_take(&target)) published++;
+
+    // The render task ends up with the last level, colour temperature and on/off state
+    CHECK_EQ(target.level, on ? (uint8_t)current_brightness : 0);
+    CHECK_EQ(target.mired, (uint16_t)mired);
+    CHECK_EQ(current_brightness, 1 + 999 % 254);
+    CHECK_EQ(mired, 200 + 997 % 256);
+    CHECK(published > 0 && (uint32_t)published + led_mailbox_get_dropped() <= MESSAGES);
+
+    // No bus traffic from the Zigbee task; only actual changes reach the write-behind store, which
+    // flushes at most once per LIGHT_STORE_MAX_INTERVAL_MS while they keep coming
+    CHECK_EQ(host_i2c_transactions - bus_transactions, 0);
+    light_store_stats_t store;
+    light_store_get_stats(&store);
+    CHECK_EQ(store.updates, changes);
+    CHECK(store.flushes + store.skipped <= MESSAGES * (uint64_t)MESSAGE_GAP_US / (LIGHT_STORE_MAX_INTERVAL_MS * 1000) + 1);
+
+    zigbee_cb_stats_t cb;
+    zigbee_get_callback_stats(&cb);
+    CHECK_EQ(cb.count, MESSAGES);
+
+    int64_t legacy_us = legacy_callback_bus_us();
+    printf("attribute callback: %d messages (%lu changes), avg %.0f ns, max %.0f ns on this host; "
+           "%d targets taken, %lu overwritten\n", MESSAGES, (unsigned long)changes, total_ns / MESSAGES, max_ns,
+           published, (unsigned long)led_mailbox_get_dropped());
+    printf("before the mailbox: %lld us of blocking I2C per message at 100 kHz, plus an NVS commit\n",
+           (long long)legacy_us);
+}
+
+int main(void)
+{
+    bench_attribute_callback();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stdio.h>
+
+// Minimal checks for the host tests: a failed check prints where and what, the test carries on,
+// and HOST_TEST_RESULT() makes the executable fail for ctest.
+static int host_test_failures = 0;
+
+#define CHECK(cond)                                                                     \
+    do {                                                                                \
+        if (!(cond)) {                                                                  \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);             \
+            host_test_failures++;                                                       \
+        }                                                                               \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                      \
+    do {                                                                                \
+        long long a_ = (long long)(actual), e_ = (long long)(expected);                 \
+        if (a_ != e_) {                                                                 \
+            printf("%s:%d: %s == %lld, expected %lld\n", __FILE__, __LINE__, #actual,   \
+                   a_, e_);                                                             \
+            host_test_failures++;                                                       \
+        }                                                                               \
+    } while (0)
+
+#define HOST_TEST_RESULT()                                                              \
+    (printf("%s: %s\n", __FILE__, host_test_failures ? "FAILED" : "passed"), host_test_failures != 0)
@@ -0,0 +1,16 @@
+#pragma once
+// Host stand-in: the GPIO calls the drivers make, all ignored
+#include <stdint.h>
+#include "esp_err.h"
+#include "hal/gpio_types.h"
+
+typedef struct {
+    uint64_t pin_bit_mask;
+    gpio_mode_t mode;
+    gpio_pullup_t pull_up_en;
+    gpio_pulldown_t pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+
+esp_err_t gpio_config(const gpio_config_t *cfg);
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
@@ -0,0 +1,4 @@
+#pragma once
+// Host stand-in: like the real header it brings in FreeRTOS, which esp_zigbee_core.h relies on
+#include "freertos/FreeRTOS.h"
+#include "hal/uart_types.h"
@@ -0,0 +1,6 @@
+#pragma once
+// Host stand-in: only named by the Zigbee platform config
+
+typedef struct {
+    int unused;
+} esp_ieee802154_frame_info_t;
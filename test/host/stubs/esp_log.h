@@ -0,0 +1,16 @@
+#pragma once
+// Host stand-in: logging compiles away, the tests report through host_test.h. The arguments are
+// still type-checked against the format and count as used.
+#include <stdio.h>
+
+#define HOST_LOG_DISCARD(tag, fmt, ...)                 \
+    do {                                                \
+        (void)(tag);                                    \
+        if (0) printf(fmt, ##__VA_ARGS__);              \
+    } while (0)
+
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG_DISCARD(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG_DISCARD(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) HOST_LOG_DISCARD(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) HOST_LOG_DISCARD(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) HOST_LOG_DISCARD(tag, fmt, ##__VA_ARGS__)
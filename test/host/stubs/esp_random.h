@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in: a fixed pseudo-random sequence, so runs repeat
+#include <stdint.h>
+
+uint32_t esp_random(void);
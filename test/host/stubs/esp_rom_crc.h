@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in: same CRC-32 (IEEE, reflected) as the ROM routine
+#include <stdint.h>
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in: a heap that never moves
+#include <stddef.h>
+
+size_t esp_get_free_heap_size(void);
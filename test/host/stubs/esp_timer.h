@@ -0,0 +1,5 @@
+#pragma once
+// Host stand-in: the clock is host_time_us (host_fakes.h), moved by the tests
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
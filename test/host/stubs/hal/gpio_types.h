@@ -0,0 +1,8 @@
+#pragma once
+// Host stand-in: the GPIO types the drivers and the Zigbee platform config use
+
+typedef enum { GPIO_NUM_10 = 10, GPIO_NUM_15 = 15 } gpio_num_t;
+typedef enum { GPIO_MODE_OUTPUT = 2 } gpio_mode_t;
+typedef enum { GPIO_PULLUP_DISABLE, GPIO_PULLUP_ENABLE } gpio_pullup_t;
+typedef enum { GPIO_PULLDOWN_DISABLE, GPIO_PULLDOWN_ENABLE } gpio_pulldown_t;
+typedef enum { GPIO_INTR_DISABLE } gpio_int_type_t;
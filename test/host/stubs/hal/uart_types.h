@@ -0,0 +1,7 @@
+#pragma once
+// Host stand-in: the UART types the Zigbee platform config names; no UART is used on the host
+
+typedef int uart_port_t;
+typedef struct {
+    int baud_rate;
+} uart_config_t;
@@ -0,0 +1,467 @@
+// Fake implementations of the ESP-IDF functions the tested modules call
+#include "host_fakes.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_mac.h"
+#include "nvs_flash.h"
+#include "esp_system.h"
+#include "esp_random.h"
+#include "driver/i2c_master.h"
+#include "driver/gpio.h"
+#include "freertos/task.h"
+#include <string.h>
+#include <time.h>
+#include <ucontext.h>
+
+int64_t host_time_us = 0;
+
+int64_t esp_timer_get_time(void)
+{
+    return host_time_us;
+}
+
+esp_cpu_cycle_count_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (esp_cpu_cycle_count_t)(ts.tv_sec * 1000000000LL + ts.tv_nsec);
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    return code == ESP_OK ? "ESP_OK" : "ESP_ERR";
+}
+
+uint8_t host_flash[HOST_FLASH_MAX];
+size_t host_flash_size = 0;
+uint32_t host_flash_erases = 0;
+uint32_t host_flash_bad_writes = 0;
+int host_flash_fail_writes = 0;
+
+static esp_partition_t host_partition = {
+    .type = ESP_PARTITION_TYPE_DATA,
+    .subtype = ESP_PARTITION_SUBTYPE_ANY,
+    .erase_size = HOST_FLASH_SECTOR,
+    .label = "journal",
+};
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    if (host_flash_size == 0 || strcmp(label, host_partition.label) != 0) return NULL;
+    host_partition.size = (uint32_t)host_flash_size;
+    return &host_partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size)
+{
+    if (offset + size > part->size) return ESP_ERR_INVALID_SIZE;
+    memcpy(dst, &host_flash[offset], size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size)
+{
+    if (offset + size > part->size) return ESP_ERR_INVALID_SIZE;
+    if (host_flash_fail_writes > 0) {
+        host_flash_fail_writes--;
+        return ESP_FAIL;
+    }
+    const uint8_t *p = src;
+    for (size_t i = 0; i < size; i++) {
+        if (p[i] & ~host_flash[offset + i]) host_flash_bad_writes++;
+        host_flash[offset + i] &= p[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    if (offset % HOST_FLASH_SECTOR || size % HOST_FLASH_SECTOR || offset + size > part->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(&host_flash[offset], 0xFF, size);
+    host_flash_erases++;
+    return ESP_OK;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int bit = 0; bit < 8; bit++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+#define HOST_TASK_MAX       8
+#define HOST_TASK_STACK     (256 * 1024)    // host frames are far larger than on the C6
+
+struct host_task {
+    TaskFunction_t fn;
+    void *arg;
+    ucontext_t context;
+    int64_t wake_us;        // HOST_TASK_NEVER: only a notification wakes it
+    bool notify_wait;
+    uint32_t notified;
+};
+
+static struct host_task host_tasks[HOST_TASK_MAX];
+static size_t host_task_count;
+static struct host_task *host_task_current;
+static ucontext_t host_task_caller;
+
+static void host_task_entry(void)
+{
+    host_task_current->fn(host_task_current->arg);
+    abort();    // FreeRTOS tasks never return
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle)
+{
+    if (host_task_count == HOST_TASK_MAX) return pdFAIL;
+    struct host_task *task = &host_tasks[host_task_count++];
+    memset(task, 0, sizeof(*task));
+    task->fn = fn;
+    task->arg = arg;
+    task->wake_us = host_time_us;
+
+    getcontext(&task->context);
+    task->context.uc_stack.ss_sp = malloc(HOST_TASK_STACK);
+    task->context.uc_stack.ss_size = HOST_TASK_STACK;
+    task->context.uc_link = NULL;
+    makecontext(&task->context, host_task_entry, 0);
+
+    if (handle) *handle = task;
+    return pdPASS;
+}
+
+void host_task_run(int64_t until_us)
+{
+    while (1) {
+        struct host_task *next = NULL;
+        for (size_t i = 0; i < host_task_count; i++) {
+            struct host_task *task = &host_tasks[i];
+            if (task->wake_us <= until_us && (next == NULL || task->wake_us < next->wake_us)) next = task;
+        }
+        if (next == NULL) break;
+
+        if (next->wake_us > host_time_us) host_time_us = next->wake_us;
+        host_task_current = next;
+        swapcontext(&host_task_caller, &next->context);
+        host_task_current = NULL;
+    }
+    if (host_time_us < until_us) host_time_us = until_us;
+}
+
+void host_task_reset(void)
+{
+    // The coroutine stacks are leaked: a task can be parked anywhere on its own
+    host_task_count = 0;
+}
+
+void host_task_wait_until(int64_t wake_us)
+{
+    struct host_task *task = host_task_current;
+    if (task == NULL) return;
+    if (task->notified) return;
+    task->wake_us = wake_us;
+    task->notify_wait = true;
+    swapcontext(&task->context, &host_task_caller);
+    task->notify_wait = false;
+}
+
+static int64_t host_tick_us(TickType_t tick)
+{
+    return (int64_t)tick * portTICK_PERIOD_MS * 1000;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(host_time_us / (portTICK_PERIOD_MS * 1000));
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return host_task_current;
+}
+
+// Wakes on the tick interrupt, as FreeRTOS does
+void vTaskDelay(TickType_t ticks)
+{
+    struct host_task *task = host_task_current;
+    if (task == NULL) return;
+    task->wake_us = host_tick_us(xTaskGetTickCount() + ticks);
+    swapcontext(&task->context, &host_task_caller);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct host_task *task = host_task_current;
+    if (task == NULL) return 0;
+    if (task->notified == 0 && ticks != 0) {
+        host_task_wait_until(ticks == portMAX_DELAY ? HOST_TASK_NEVER : host_tick_us(xTaskGetTickCount() + ticks));
+    }
+    uint32_t value = task->notified;
+    if (clear_on_exit) {
+        task->notified = 0;
+    } else if (value) {
+        task->notified--;
+    }
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    task->notified++;
+    if (task->notify_wait && task->wake_us > host_time_us) task->wake_us = host_time_us;
+    return pdPASS;
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+    memset(mac, 0x02, 6);
+    return ESP_OK;
+}
+
+#define HOST_NVS_ENTRIES    16
+#define HOST_NVS_NAMESPACES 4
+
+typedef struct {
+    uint8_t space;      // index into host_nvs_spaces + 1, 0 = free
+    char key[16];
+    uint8_t value[64];
+    size_t length;
+} host_nvs_entry_t;
+
+bool host_nvs_enabled = false;
+uint32_t host_nvs_writes = 0;
+uint32_t host_nvs_commits = 0;
+static char host_nvs_spaces[HOST_NVS_NAMESPACES][16];
+static host_nvs_entry_t host_nvs[HOST_NVS_ENTRIES];
+
+void host_nvs_reset(void)
+{
+    memset(host_nvs_spaces, 0, sizeof(host_nvs_spaces));
+    memset(host_nvs, 0, sizeof(host_nvs));
+    host_nvs_writes = 0;
+    host_nvs_commits = 0;
+}
+
+// Handles are namespace indices + 1
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *handle)
+{
+    if (!host_nvs_enabled) return ESP_ERR_NOT_FOUND;
+    for (size_t i = 0; i < HOST_NVS_NAMESPACES; i++) {
+        if (host_nvs_spaces[i][0] == '\0') {
+            if (mode == NVS_READONLY) return ESP_ERR_NVS_NOT_FOUND;
+            strncpy(host_nvs_spaces[i], name, sizeof(host_nvs_spaces[i]) - 1);
+        }
+        if (strcmp(host_nvs_spaces[i], name) == 0) {
+            *handle = (nvs_handle_t)(i + 1);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+static host_nvs_entry_t *host_nvs_find(nvs_handle_t handle, const char *key)
+{
+    for (size_t i = 0; i < HOST_NVS_ENTRIES; i++) {
+        if (host_nvs[i].space == handle && strcmp(host_nvs[i].key, key) == 0) return &host_nvs[i];
+    }
+    return NULL;
+}
+
+static esp_err_t host_nvs_get(nvs_handle_t handle, const char *key, void *out, size_t *length)
+{
+    host_nvs_entry_t *entry = host_nvs_find(handle, key);
+    if (entry == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    if (out == NULL || *length < entry->length) {
+        *length = entry->length;
+        return out == NULL ? ESP_OK : ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(out, entry->value, entry->length);
+    *length = entry->length;
+    return ESP_OK;
+}
+
+static esp_err_t host_nvs_set(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    host_nvs_entry_t *entry = host_nvs_find(handle, key);
+    for (size_t i = 0; entry == NULL && i < HOST_NVS_ENTRIES; i++) {
+        if (host_nvs[i].space == 0) entry = &host_nvs[i];
+    }
+    if (entry == NULL || length > sizeof(entry->value)) return ESP_ERR_NO_MEM;
+    entry->space = (uint8_t)handle;
+    strncpy(entry->key, key, sizeof(entry->key) - 1);
+    memcpy(entry->value, value, length);
+    entry->length = length;
+    host_nvs_writes++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out, size_t *length)
+{
+    return host_nvs_get(handle, key, out, length);
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key, int32_t *out)
+{
+    size_t length = sizeof(*out);
+    return host_nvs_get(handle, key, out, &length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return host_nvs_set(handle, key, value, length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    host_nvs_entry_t *entry = host_nvs_find(handle, key);
+    if (entry == NULL) return ESP_ERR_NVS_NOT_FOUND;
+    memset(entry, 0, sizeof(*entry));
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    host_nvs_commits++;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    return ESP_OK;
+}
+
+size_t esp_get_free_heap_size(void)
+{
+    return 256 * 1024;
+}
+
+uint32_t esp_random(void)
+{
+    static uint32_t state = 1;
+    state = state * 1103515245u + 12345u;
+    return state;
+}
+
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+    return ESP_OK;
+}
+
+#define HOST_I2C_MAX_DEVICES 8
+
+struct i2c_master_dev_t {
+    uint16_t address;
+    uint32_t scl_speed_hz;
+};
+
+static struct i2c_master_dev_t host_i2c_handles[HOST_I2C_MAX_DEVICES];
+static size_t host_i2c_handle_count;
+static host_i2c_device_t *host_i2c_devices[HOST_I2C_MAX_DEVICES];
+uint32_t host_i2c_transactions = 0;
+uint32_t host_i2c_bytes = 0;
+int64_t host_i2c_busy_us = 0;
+bool host_i2c_clocked = false;
+
+void host_i2c_attach(host_i2c_device_t *dev)
+{
+    for (size_t i = 0; i < HOST_I2C_MAX_DEVICES; i++) {
+        if (host_i2c_devices[i] == NULL || host_i2c_devices[i]->address == dev->address) {
+            host_i2c_devices[i] = dev;
+            return;
+        }
+    }
+    abort();
+}
+
+void host_i2c_reset(void)
+{
+    memset(host_i2c_devices, 0, sizeof(host_i2c_devices));
+    host_i2c_transactions = 0;
+    host_i2c_bytes = 0;
+    host_i2c_busy_us = 0;
+}
+
+static host_i2c_device_t *host_i2c_find(i2c_master_dev_handle_t handle)
+{
+    for (size_t i = 0; i < HOST_I2C_MAX_DEVICES && host_i2c_devices[i] != NULL; i++) {
+        if (host_i2c_devices[i]->address == handle->address) return host_i2c_devices[i];
+    }
+    return NULL;
+}
+
+// One transaction of `bytes` bytes (address bytes included) and `starts` start conditions
+static void host_i2c_account(i2c_master_dev_handle_t handle, size_t bytes, int starts)
+{
+    int64_t clocks = (int64_t)bytes * 9 + starts + 1;
+    int64_t us = (clocks * 1000000 + handle->scl_speed_hz - 1) / handle->scl_speed_hz;
+
+    host_i2c_transactions++;
+    host_i2c_bytes += bytes;
+    host_i2c_busy_us += us;
+    if (host_i2c_clocked) host_time_us += us;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *cfg,
+                                    i2c_master_dev_handle_t *dev)
+{
+    // Drivers re-initialised by a test get their handle back rather than using up the pool
+    for (size_t i = 0; i < host_i2c_handle_count; i++) {
+        if (host_i2c_handles[i].address == cfg->device_address) {
+            *dev = &host_i2c_handles[i];
+            return ESP_OK;
+        }
+    }
+    if (host_i2c_handle_count == HOST_I2C_MAX_DEVICES) return ESP_ERR_NO_MEM;
+    i2c_master_dev_handle_t handle = &host_i2c_handles[host_i2c_handle_count++];
+    handle->address = cfg->device_address;
+    handle->scl_speed_hz = cfg->scl_speed_hz ? cfg->scl_speed_hz : 100000;
+    *dev = handle;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *data, size_t len, int timeout_ms)
+{
+    host_i2c_device_t *target = host_i2c_find(dev);
+    host_i2c_account(dev, target ? 1 + len : 1, 1);
+    if (target == NULL || target->write == NULL) return ESP_FAIL;
+    return target->write(target, data, len);
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t *data, size_t len, int timeout_ms)
+{
+    host_i2c_device_t *target = host_i2c_find(dev);
+    host_i2c_account(dev, target ? 1 + len : 1, 1);
+    if (target == NULL || target->read == NULL) return ESP_FAIL;
+    return target->read(target, data, len);
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev, const uint8_t *tx, size_t tx_len,
+                                      uint8_t *rx, size_t rx_len, int timeout_ms)
+{
+    host_i2c_device_t *target = host_i2c_find(dev);
+    host_i2c_account(dev, target ? 2 + tx_len + rx_len : 1, 2);
+    if (target == NULL || target->write == NULL || target->read == NULL) return ESP_FAIL;
+    esp_err_t err = target->write(target, tx, tx_len);
+    if (err != ESP_OK) return err;
+    return target->read(target, rx, rx_len);
+}
@@ -0,0 +1,60 @@
+#pragma once
+// Controls for the fakes in host_fakes.c
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// What esp_timer_get_time() returns
+extern int64_t host_time_us;
+
+// Flash behind esp_partition_*: NOR semantics, so a write can only clear bits and a sector has
+// to be erased (to 0xFF) first. host_flash_size 0 means the partition table has no partition.
+#define HOST_FLASH_SECTOR 4096
+#define HOST_FLASH_MAX    (16 * HOST_FLASH_SECTOR)
+extern uint8_t host_flash[HOST_FLASH_MAX];
+extern size_t host_flash_size;
+extern uint32_t host_flash_erases;
+extern uint32_t host_flash_bad_writes;   // writes that tried to set a cleared bit
+extern int host_flash_fail_writes;       // the next n writes fail without touching flash
+
+// NVS behind nvs.h. Disabled, every nvs_open() fails as on a device without an NVS partition;
+// enabled, it is a small key/value store in RAM that counts blob writes and commits.
+extern bool host_nvs_enabled;
+extern uint32_t host_nvs_writes;
+extern uint32_t host_nvs_commits;
+// Erase every namespace and clear the counters
+void host_nvs_reset(void);
+
+// I2C bus behind driver/i2c_master.h. A transfer goes to the device attached at the handle's
+// address and fails (as a NACK) if there is none. Every transfer is counted as on the wire:
+// address byte plus data, and a second address byte for the read half of transmit_receive.
+typedef struct host_i2c_device {
+    uint16_t address;
+    esp_err_t (*write)(struct host_i2c_device *dev, const uint8_t *data, size_t len);
+    esp_err_t (*read)(struct host_i2c_device *dev, uint8_t *data, size_t len);
+    void *ctx;
+} host_i2c_device_t;
+
+void host_i2c_attach(host_i2c_device_t *dev);
+// Detach every device and clear the counters
+void host_i2c_reset(void);
+
+extern uint32_t host_i2c_transactions;
+extern uint32_t host_i2c_bytes;          // address and data bytes
+extern int64_t host_i2c_busy_us;         // bus time: start, 9 clocks per byte, stop
+extern bool host_i2c_clocked;            // transfers move host_time_us on by their bus time
+
+// Tasks behind freertos/task.h. host_task_run() resumes whichever task is due first (creation
+// order breaks ties), moves host_time_us to its wake-up time and lets it run until it blocks
+// again; it returns once no task is due before until_us, with the clock at until_us. A
+// notification makes the waiting task due at once, but it only runs when the caller blocks or
+// returns to host_task_run(): there is no preemption.
+#define HOST_TASK_NEVER INT64_MAX
+
+void host_task_run(int64_t until_us);
+// Block the calling task until wake_us or a notification, whichever is first; a stand-in for
+// wait primitives the task fake does not model (the Zigbee stack loop)
+void host_task_wait_until(int64_t wake_us);
+// Forget every task, e.g. between the scenarios of one test
+void host_task_reset(void);
@@ -0,0 +1,168 @@
+// Fake sensor parts behind host_sensors.h
+#include "host_sensors.h"
+#include "host_fakes.h"
+#include <string.h>
+
+// ---------------- MS8607 ----------------
+#define MS8607_PT_ADDR  0x76
+#define MS8607_RH_ADDR  0x40
+
+// Datasheet worst case, by OSR (PT) and by user register resolution (RH)
+static const uint16_t ms8607_pt_conv_us[] = {600, 1170, 2280, 4540, 9040, 18080};
+static const uint16_t ms8607_rh_conv_us[] = {16000, 3000, 5000, 9000};
+
+static struct {
+    host_ms8607_t *part;
+    uint8_t pt_cmd;             // what the next PT read returns: ADC (0x00) or a PROM word
+    enum { PT_IDLE, PT_D1, PT_D2 } pt_conv;
+    bool rh_user_read;          // the next RH read returns the user register
+    bool rh_measuring;
+    uint8_t rh_user;
+} ms8607;
+
+static esp_err_t ms8607_pt_write(host_i2c_device_t *dev, const uint8_t *data, size_t len)
+{
+    host_ms8607_t *part = ms8607.part;
+    uint8_t cmd = data[0];
+    if (cmd == 0x1E) {
+        ms8607.pt_conv = PT_IDLE;
+    } else if ((cmd & 0xE0) == 0x40 && (cmd & 0x0F) / 2 < 6) {
+        ms8607.pt_conv = cmd & 0x10 ? PT_D2 : PT_D1;
+        part->pt_conv_end_us = host_time_us + ms8607_pt_conv_us[(cmd & 0x0F) / 2];
+        part->pt_conversions++;
+    } else {
+        ms8607.pt_cmd = cmd;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ms8607_pt_read(host_i2c_device_t *dev, uint8_t *data, size_t len)
+{
+    host_ms8607_t *part = ms8607.part;
+    uint32_t value = 0;
+    if (ms8607.pt_cmd >= 0xA0 && ms8607.pt_cmd <= 0xAE) {
+        value = part->prom[(ms8607.pt_cmd - 0xA0) / 2];
+    } else if (ms8607.pt_conv != PT_IDLE && host_time_us < part->pt_conv_end_us) {
+        part->pt_early_reads++;
+    } else if (ms8607.pt_conv != PT_IDLE) {
+        value = ms8607.pt_conv == PT_D1 ? part->d1 : part->d2;
+        ms8607.pt_conv = PT_IDLE;
+    }
+    for (size_t i = 0; i < len; i++) data[i] = (uint8_t)(value >> (8 * (len - 1 - i)));
+    return ESP_OK;
+}
+
+// CRC-8 (x^8 + x^5 + x^4 + 1) the RH die appends to its result
+static uint8_t ms8607_rh_crc(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) crc = (uint8_t)(crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1);
+    }
+    return crc;
+}
+
+static esp_err_t ms8607_rh_write(host_i2c_device_t *dev, const uint8_t *data, size_t len)
+{
+    host_ms8607_t *part = ms8607.part;
+    switch (data[0]) {
+    case 0xFE:
+        ms8607.rh_user = 0x02;
+        ms8607.rh_measuring = false;
+        break;
+    case 0xE6:
+        if (len < 2) return ESP_FAIL;
+        ms8607.rh_user = data[1];
+        break;
+    case 0xE7:
+        ms8607.rh_user_read = true;
+        break;
+    case 0xF5:
+        part->rh_conv_end_us = host_time_us + ms8607_rh_conv_us[((ms8607.rh_user >> 6) & 0x2) | (ms8607.rh_user & 0x1)];
+        ms8607.rh_measuring = true;
+        break;
+    default:
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ms8607_rh_read(host_i2c_device_t *dev, uint8_t *data, size_t len)
+{
+    host_ms8607_t *part = ms8607.part;
+    if (ms8607.rh_user_read) {
+        ms8607.rh_user_read = false;
+        data[0] = ms8607.rh_user;
+        return ESP_OK;
+    }
+    if (!ms8607.rh_measuring) return ESP_FAIL;
+    if (host_time_us < part->rh_conv_end_us) {
+        part->rh_nacks++;
+        return ESP_FAIL;
+    }
+    ms8607.rh_measuring = false;
+    uint8_t result[3] = {(uint8_t)(part->rh_raw >> 8), (uint8_t)part->rh_raw};
+    result[2] = ms8607_rh_crc(result, 2);
+    memcpy(data, result, len < 3 ? len : 3);
+    return ESP_OK;
+}
+
+static host_i2c_device_t ms8607_pt = {.address = MS8607_PT_ADDR, .write = ms8607_pt_write, .read = ms8607_pt_read};
+static host_i2c_device_t ms8607_rh = {.address = MS8607_RH_ADDR, .write = ms8607_rh_write, .read = ms8607_rh_read};
+
+void host_ms8607_attach(host_ms8607_t *part)
+{
+    memset(&ms8607, 0, sizeof(ms8607));
+    ms8607.part = part;
+    ms8607.rh_user = 0x02;
+    host_i2c_attach(&ms8607_pt);
+    host_i2c_attach(&ms8607_rh);
+}
+
+// ---------------- TC74 ----------------
+#define TC74_ADDR 0x4C
+
+static struct {
+    host_tc74_t *part;
+    uint8_t reg;
+    int64_t valid_us;           // first time the converter has a reading
+} tc74;
+
+static esp_err_t tc74_write(host_i2c_device_t *dev, const uint8_t *data, size_t len)
+{
+    host_tc74_t *part = tc74.part;
+    if (data[0] > 0x01) return ESP_FAIL;
+    tc74.reg = data[0];
+    if (len >= 2 && tc74.reg == 0x01) {
+        if ((part->config & 0x80) && !(data[1] & 0x80)) tc74.valid_us = host_time_us + HOST_TC74_SETTLE_US;
+        part->config = data[1];
+    }
+    return ESP_OK;
+}
+
+static esp_err_t tc74_read(host_i2c_device_t *dev, uint8_t *data, size_t len)
+{
+    host_tc74_t *part = tc74.part;
+    if (tc74.reg == 0x01) {
+        data[0] = part->config;
+        return ESP_OK;
+    }
+    part->reads++;
+    if ((part->config & 0x80) || host_time_us < tc74.valid_us) {
+        part->unsettled_reads++;
+        data[0] = 0;
+    } else {
+        data[0] = (uint8_t)part->temperature;
+    }
+    return ESP_OK;
+}
+
+static host_i2c_device_t tc74_dev = {.address = TC74_ADDR, .write = tc74_write, .read = tc74_read};
+
+void host_tc74_attach(host_tc74_t *part)
+{
+    memset(&tc74, 0, sizeof(tc74));
+    tc74.part = part;
+    host_i2c_attach(&tc74_dev);
+}
@@ -0,0 +1,36 @@
+#pragma once
+// Sensor parts on the fake I2C bus (host_fakes.h), timed by host_time_us
+#include <stdint.h>
+#include "esp_err.h"
+
+// MS8607: the PT die at 0x76 and the RH die at 0x40. Conversions take the datasheet worst-case
+// times from the command that starts them. An ADC read before the PT conversion has ended
+// returns 0, as the part does; the RH die NACKs a read while it is still measuring.
+typedef struct {
+    uint16_t prom[8];           // words 0..6 as programmed, CRC included
+    uint32_t d1, d2;            // pressure and temperature ADC results
+    uint16_t rh_raw;            // humidity result, status bits included
+    // Observed
+    int64_t pt_conv_end_us;     // end of the last PT conversion started
+    int64_t rh_conv_end_us;     // end of the last RH measurement started
+    uint32_t pt_conversions;
+    uint32_t pt_early_reads;    // ADC reads before the conversion had ended
+    uint32_t rh_nacks;          // result reads before the measurement had ended
+} host_ms8607_t;
+
+// Attach both dies with the part reset
+void host_ms8607_attach(host_ms8607_t *part);
+
+// TC74 at 0x4C: the temperature and config registers. Leaving standby (config bit 7) restarts
+// the converter; a temperature read in standby or less than HOST_TC74_SETTLE_US after it returns 0.
+#define HOST_TC74_SETTLE_US 200000
+
+typedef struct {
+    int8_t temperature;         // C
+    uint8_t config;             // 0x80 = standby
+    // Observed
+    uint32_t reads;
+    uint32_t unsettled_reads;   // temperature reads in standby or before the settle time
+} host_tc74_t;
+
+void host_tc74_attach(host_tc74_t *part);
@@ -0,0 +1,460 @@
+// Zigbee stack fake behind esp_zigbee_core.h: enough of the stack for zigbee_app.c and its
+// modules to run on the host (host_zigbee.h)
+#include "host_zigbee.h"
+#include "host_fakes.h"
+#include "freertos/task.h"
+#include <string.h>
+
+static esp_zb_core_action_callback_t action_handler;
+static esp_zb_zcl_raw_command_callback_t raw_command_handler;
+static esp_zb_zcl_command_send_status_callback_t send_status_handler;
+static TaskHandle_t zb_task;
+
+static void host_zb_attr_from_message(const void *message);
+static int64_t host_zb_reporting_run(void);
+static void host_zb_reporting_reset(void);
+
+esp_err_t host_zb_action(esp_zb_core_action_callback_id_t callback_id, const void *message)
+{
+    if (action_handler == NULL) return ESP_ERR_INVALID_STATE;
+    // The stack has stored the new value before it tells the application
+    if (callback_id == ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID) host_zb_attr_from_message(message);
+    return action_handler(callback_id, message);
+}
+
+void esp_zb_core_action_handler_register(esp_zb_core_action_callback_t cb)
+{
+    action_handler = cb;
+}
+
+void esp_zb_raw_command_handler_register(esp_zb_zcl_raw_command_callback_t cb)
+{
+    raw_command_handler = cb;
+}
+
+// The one raw command buffer: parsed header in the buffer's parameter area, payload in its body
+static zb_zcl_parsed_hdr_t raw_header;
+static uint8_t raw_payload[64];
+static size_t raw_len;
+
+void *host_zb_buf_param(uint8_t bufid)
+{
+    return &raw_header;
+}
+
+void *zb_buf_begin(uint8_t bufid)
+{
+    return raw_payload;
+}
+
+zb_uint_t zb_buf_len(uint8_t bufid)
+{
+    return (zb_uint_t)raw_len;
+}
+
+bool host_zb_raw_command(const zb_zcl_parsed_hdr_t *header, const uint8_t *payload, size_t len)
+{
+    if (raw_command_handler == NULL || len > sizeof(raw_payload)) return false;
+    raw_header = *header;
+    memcpy(raw_payload, payload, len);
+    raw_len = len;
+    return raw_command_handler(1);
+}
+
+// Scheduler alarms, run by esp_zb_stack_main_loop() in the Zigbee task
+#define HOST_ZB_ALARMS 16
+
+typedef struct {
+    esp_zb_callback_t cb;
+    uint8_t param;
+    int64_t due_us;
+} host_zb_alarm_t;
+
+static host_zb_alarm_t alarms[HOST_ZB_ALARMS];
+
+void esp_zb_scheduler_alarm(esp_zb_callback_t cb, uint8_t param, uint32_t time)
+{
+    for (size_t i = 0; i < HOST_ZB_ALARMS; i++) {
+        if (alarms[i].cb != NULL) continue;
+        alarms[i] = (host_zb_alarm_t){.cb = cb, .param = param, .due_us = host_time_us + (int64_t)time * 1000};
+        // Set from outside the Zigbee task (a test playing the stack): let the loop see it
+        if (zb_task != NULL && xTaskGetCurrentTaskHandle() != zb_task) xTaskNotifyGive(zb_task);
+        return;
+    }
+    abort();
+}
+
+void esp_zb_scheduler_alarm_cancel(esp_zb_callback_t cb, uint8_t param)
+{
+    for (size_t i = 0; i < HOST_ZB_ALARMS; i++) {
+        if (alarms[i].cb == cb && alarms[i].param == param) alarms[i].cb = NULL;
+    }
+}
+
+void esp_zb_stack_main_loop(void)
+{
+    zb_task = xTaskGetCurrentTaskHandle();
+    while (1) {
+        host_zb_alarm_t *next = NULL;
+        for (size_t i = 0; i < HOST_ZB_ALARMS; i++) {
+            if (alarms[i].cb != NULL && (next == NULL || alarms[i].due_us < next->due_us)) next = &alarms[i];
+        }
+        int64_t report_due = host_zb_reporting_run();
+        if (next == NULL || next->due_us > host_time_us) {
+            int64_t wake = next ? next->due_us : HOST_TASK_NEVER;
+            host_task_wait_until(report_due < wake ? report_due : wake);
+            ulTaskNotifyTake(pdTRUE, 0);
+            continue;
+        }
+        host_zb_alarm_t alarm = *next;
+        next->cb = NULL;
+        alarm.cb(alarm.param);
+    }
+}
+
+void host_zb_reset(void)
+{
+    action_handler = NULL;
+    raw_command_handler = NULL;
+    send_status_handler = NULL;
+    zb_task = NULL;
+    host_zb_reporting_reset();
+    memset(alarms, 0, sizeof(alarms));
+    memset(&host_zb_commissioning, 0, sizeof(host_zb_commissioning));
+    host_zb_channel = 11;
+    host_zb_joined = false;
+    memset(host_zb_ext_pan_id, 0, sizeof(host_zb_ext_pan_id));
+}
+
+// Device, cluster and network set-up: accepted, nothing is modelled behind it
+static uint8_t dummy_list;
+
+void esp_zb_init(esp_zb_cfg_t *nwk_cfg) {}
+esp_err_t esp_zb_start(bool autostart) { return ESP_OK; }
+esp_err_t esp_zb_overall_network_size_set(uint16_t size) { return ESP_OK; }
+esp_err_t esp_zb_aps_src_binding_table_size_set(uint16_t size) { return ESP_OK; }
+esp_err_t esp_zb_aps_dst_binding_table_size_set(uint16_t size) { return ESP_OK; }
+
+esp_zb_attribute_list_t *esp_zb_basic_cluster_create(esp_zb_basic_cluster_cfg_t *cfg) { return (void *)&dummy_list; }
+esp_zb_attribute_list_t *esp_zb_identify_cluster_create(esp_zb_identify_cluster_cfg_t *cfg) { return (void *)&dummy_list; }
+esp_zb_attribute_list_t *esp_zb_on_off_cluster_create(esp_zb_on_off_cluster_cfg_t *cfg) { return (void *)&dummy_list; }
+esp_zb_attribute_list_t *esp_zb_color_control_cluster_create(esp_zb_color_cluster_cfg_t *cfg) { return (void *)&dummy_list; }
+esp_zb_attribute_list_t *esp_zb_temperature_meas_cluster_create(esp_zb_temperature_meas_cluster_cfg_t *cfg) { return (void *)&dummy_list; }
+esp_zb_attribute_list_t *esp_zb_pressure_meas_cluster_create(esp_zb_pressure_meas_cluster_cfg_t *cfg) { return (void *)&dummy_list; }
+esp_zb_attribute_list_t *esp_zb_zcl_attr_list_create(uint16_t cluster_id) { return (void *)&dummy_list; }
+esp_zb_cluster_list_t *esp_zb_zcl_cluster_list_create(void) { return (void *)&dummy_list; }
+esp_zb_ep_list_t *esp_zb_ep_list_create(void) { return (void *)&dummy_list; }
+
+esp_err_t esp_zb_basic_cluster_add_attr(esp_zb_attribute_list_t *l, uint16_t id, void *v) { return ESP_OK; }
+esp_err_t esp_zb_on_off_cluster_add_attr(esp_zb_attribute_list_t *l, uint16_t id, void *v) { return ESP_OK; }
+esp_err_t esp_zb_level_cluster_add_attr(esp_zb_attribute_list_t *l, uint16_t id, void *v) { return ESP_OK; }
+esp_err_t esp_zb_color_control_cluster_add_attr(esp_zb_attribute_list_t *l, uint16_t id, void *v) { return ESP_OK; }
+esp_err_t esp_zb_pressure_meas_cluster_add_attr(esp_zb_attribute_list_t *l, uint16_t id, void *v) { return ESP_OK; }
+esp_err_t esp_zb_cluster_add_manufacturer_attr(esp_zb_attribute_list_t *l, uint16_t cluster_id, uint16_t id,
+                                               uint16_t manuf_code, uint8_t type, uint8_t access, void *v)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_zb_cluster_list_add_basic_cluster(esp_zb_cluster_list_t *c, esp_zb_attribute_list_t *l, uint8_t r) { return ESP_OK; }
+esp_err_t esp_zb_cluster_list_add_identify_cluster(esp_zb_cluster_list_t *c, esp_zb_attribute_list_t *l, uint8_t r) { return ESP_OK; }
+esp_err_t esp_zb_cluster_list_add_on_off_cluster(esp_zb_cluster_list_t *c, esp_zb_attribute_list_t *l, uint8_t r) { return ESP_OK; }
+esp_err_t esp_zb_cluster_list_add_level_cluster(esp_zb_cluster_list_t *c, esp_zb_attribute_list_t *l, uint8_t r) { return ESP_OK; }
+esp_err_t esp_zb_cluster_list_add_color_control_cluster(esp_zb_cluster_list_t *c, esp_zb_attribute_list_t *l, uint8_t r) { return ESP_OK; }
+esp_err_t esp_zb_cluster_list_update_color_control_cluster(esp_zb_cluster_list_t *c, esp_zb_attribute_list_t *l, uint8_t r) { return ESP_OK; }
+esp_err_t esp_zb_cluster_list_add_temperature_meas_cluster(esp_zb_cluster_list_t *c, esp_zb_attribute_list_t *l, uint8_t r) { return ESP_OK; }
+esp_err_t esp_zb_cluster_list_add_pressure_meas_cluster(esp_zb_cluster_list_t *c, esp_zb_attribute_list_t *l, uint8_t r) { return ESP_OK; }
+esp_err_t esp_zb_ep_list_add_ep(esp_zb_ep_list_t *e, esp_zb_cluster_list_t *c, esp_zb_endpoint_config_t cfg) { return ESP_OK; }
+esp_err_t esp_zb_device_register(esp_zb_ep_list_t *ep_list) { return ESP_OK; }
+void esp_zb_identify_notify_handler_register(uint8_t endpoint, esp_zb_identify_notify_callback_t cb) {}
+
+// Commissioning: recorded for the tests, never completes by itself. The tests drive the light
+// through the callbacks directly and report join results to the rejoin policy themselves.
+host_zb_commissioning_t host_zb_commissioning;
+uint8_t host_zb_channel = 11;
+esp_zb_ieee_addr_t host_zb_ext_pan_id;
+bool host_zb_joined;
+
+bool esp_zb_bdb_dev_joined(void) { return host_zb_joined; }
+bool esp_zb_bdb_is_factory_new(void) { return true; }
+esp_err_t esp_zb_bdb_open_network(uint8_t permit_duration) { return ESP_OK; }
+
+esp_err_t esp_zb_bdb_start_top_level_commissioning(uint8_t mode_mask)
+{
+    host_zb_commissioning.starts++;
+    host_zb_commissioning.mode = mode_mask;
+    return ESP_OK;
+}
+
+esp_err_t esp_zb_set_primary_network_channel_set(uint32_t channel_mask)
+{
+    host_zb_commissioning.primary = channel_mask;
+    return ESP_OK;
+}
+
+esp_err_t esp_zb_set_secondary_network_channel_set(uint32_t channel_mask)
+{
+    host_zb_commissioning.secondary = channel_mask;
+    return ESP_OK;
+}
+
+void esp_zb_set_extended_pan_id(const esp_zb_ieee_addr_t ext_pan_id)
+{
+    memcpy(host_zb_commissioning.ext_pan_id, ext_pan_id, sizeof(esp_zb_ieee_addr_t));
+}
+
+uint8_t esp_zb_get_current_channel(void) { return host_zb_channel; }
+void esp_zb_get_extended_pan_id(esp_zb_ieee_addr_t ext_pan_id) { memcpy(ext_pan_id, host_zb_ext_pan_id, sizeof(esp_zb_ieee_addr_t)); }
+uint16_t esp_zb_get_pan_id(void) { return 0xFFFF; }
+uint16_t esp_zb_get_short_address(void) { return 0xFFFE; }
+esp_err_t esp_zb_nwk_get_next_neighbor(esp_zb_nwk_info_iterator_t *it, esp_zb_nwk_neighbor_info_t *nbr) { return ESP_ERR_NOT_FOUND; }
+void *esp_zb_app_signal_get_params(uint32_t *signal_p) { return NULL; }
+const char *esp_zb_zdo_signal_to_string(esp_zb_app_signal_type_t signal) { return "signal"; }
+
+// Attributes and the reporting engine. Only the attributes the application reports are stored;
+// the engine sends a report once the value moved by the reportable change (any change if it is
+// 0) and the min interval passed since the last report, or when the max interval runs out.
+#define HOST_ZB_ATTRS     16
+#define HOST_ZB_REPORTING 16
+
+typedef struct {
+    bool used;
+    uint8_t ep;
+    uint16_t cluster;
+    uint16_t attr;
+    int32_t value;
+} host_zb_attr_t;
+
+typedef struct {
+    bool used;
+    esp_zb_zcl_reporting_info_t info;
+    int32_t reported;
+    int64_t last_report_us;
+    uint32_t reports;
+} host_zb_reporting_t;
+
+static host_zb_attr_t attrs[HOST_ZB_ATTRS];
+static host_zb_reporting_t reporting[HOST_ZB_REPORTING];
+uint32_t host_zb_reports;
+int64_t host_zb_report_log[HOST_ZB_REPORT_LOG];
+
+// Size and signedness of the reportable attributes; 0 for the ones the fake does not keep
+static size_t attr_size(uint16_t cluster, uint16_t attr, bool *is_signed)
+{
+    *is_signed = false;
+    switch (cluster) {
+    case ESP_ZB_ZCL_CLUSTER_ID_ON_OFF:
+        return attr == ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID ? 1 : 0;
+    case ESP_ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL:
+        return attr == ESP_ZB_ZCL_ATTR_LEVEL_CONTROL_CURRENT_LEVEL_ID ? 1 : 0;
+    case ESP_ZB_ZCL_CLUSTER_ID_COLOR_CONTROL:
+        return attr == ESP_ZB_ZCL_ATTR_COLOR_CONTROL_COLOR_TEMPERATURE_ID ? 2 : 0;
+    case ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT:
+    case ESP_ZB_ZCL_CLUSTER_ID_PRESSURE_MEASUREMENT:
+        *is_signed = true;
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+static int32_t attr_decode(const void *value_p, size_t size, bool is_signed)
+{
+    if (size == 1) return *(const uint8_t *)value_p;
+    uint16_t raw;
+    memcpy(&raw, value_p, sizeof(raw));
+    return is_signed ? (int16_t)raw : raw;
+}
+
+static host_zb_attr_t *attr_find(uint8_t ep, uint16_t cluster, uint16_t attr, bool create)
+{
+    host_zb_attr_t *free_slot = NULL;
+    for (size_t i = 0; i < HOST_ZB_ATTRS; i++) {
+        if (attrs[i].used && attrs[i].ep == ep && attrs[i].cluster == cluster && attrs[i].attr == attr) return &attrs[i];
+        if (!attrs[i].used && free_slot == NULL) free_slot = &attrs[i];
+    }
+    if (!create) return NULL;
+    if (free_slot == NULL) abort();
+    *free_slot = (host_zb_attr_t){.used = true, .ep = ep, .cluster = cluster, .attr = attr};
+    return free_slot;
+}
+
+static int32_t attr_value(uint8_t ep, uint16_t cluster, uint16_t attr)
+{
+    host_zb_attr_t *a = attr_find(ep, cluster, attr, false);
+    return a ? a->value : 0;
+}
+
+// The engine runs in the Zigbee task: wake it when something changes from outside
+static void reporting_kick(void)
+{
+    if (zb_task != NULL && xTaskGetCurrentTaskHandle() != zb_task) xTaskNotifyGive(zb_task);
+}
+
+static void attr_store(uint8_t ep, uint16_t cluster, uint16_t attr, const void *value_p)
+{
+    bool is_signed;
+    size_t size = attr_size(cluster, attr, &is_signed);
+    if (size == 0 || value_p == NULL) return;
+    attr_find(ep, cluster, attr, true)->value = attr_decode(value_p, size, is_signed);
+    reporting_kick();
+}
+
+static void host_zb_attr_from_message(const void *message)
+{
+    const esp_zb_zcl_set_attr_value_message_t *msg = message;
+    attr_store(msg->info.dst_endpoint, msg->info.cluster, msg->attribute.id, msg->attribute.data.value);
+}
+
+static uint32_t reporting_delta(const host_zb_reporting_t *r)
+{
+    bool is_signed;
+    size_t size = attr_size(r->info.cluster_id, r->info.attr_id, &is_signed);
+    uint32_t delta = size == 1 ? r->info.u.send_info.delta.u8 : r->info.u.send_info.delta.u16;
+    return delta ? delta : 1;
+}
+
+// When the entry's next report is due; HOST_TASK_NEVER if it is not
+static int64_t reporting_due_us(const host_zb_reporting_t *r)
+{
+    uint16_t min_s = r->info.u.send_info.min_interval;
+    uint16_t max_s = r->info.u.send_info.max_interval;
+    if (r->info.direction != ESP_ZB_ZCL_REPORT_DIRECTION_SEND || max_s == 0xFFFF) return HOST_TASK_NEVER;
+
+    int64_t due = HOST_TASK_NEVER;
+    int32_t moved = attr_value(r->info.ep, r->info.cluster_id, r->info.attr_id) - r->reported;
+    if ((uint32_t)(moved < 0 ? -moved : moved) >= reporting_delta(r)) due = r->last_report_us + min_s * 1000000LL;
+    if (max_s != 0 && r->last_report_us + max_s * 1000000LL < due) due = r->last_report_us + max_s * 1000000LL;
+    return due;
+}
+
+static void reporting_send(host_zb_reporting_t *r)
+{
+    r->reported = attr_value(r->info.ep, r->info.cluster_id, r->info.attr_id);
+    r->info.u.send_info.reported_value.s32 = r->reported;
+    r->last_report_us = host_time_us;
+    r->reports++;
+    if (host_zb_reports < HOST_ZB_REPORT_LOG) host_zb_report_log[host_zb_reports] = host_time_us;
+    host_zb_reports++;
+    if (send_status_handler != NULL) {
+        esp_zb_zcl_command_send_status_message_t status = {.status = ESP_OK, .src_endpoint = r->info.ep};
+        send_status_handler(status);
+    }
+}
+
+// Send what is due; returns when the engine needs to run next
+static int64_t host_zb_reporting_run(void)
+{
+    int64_t next = HOST_TASK_NEVER;
+    for (size_t i = 0; i < HOST_ZB_REPORTING; i++) {
+        if (!reporting[i].used) continue;
+        int64_t due = reporting_due_us(&reporting[i]);
+        if (due <= host_time_us) {
+            reporting_send(&reporting[i]);
+            due = reporting_due_us(&reporting[i]);
+        }
+        if (due < next) next = due;
+    }
+    return next;
+}
+
+static host_zb_reporting_t *reporting_find(uint8_t ep, uint16_t cluster, uint16_t attr)
+{
+    for (size_t i = 0; i < HOST_ZB_REPORTING; i++) {
+        host_zb_reporting_t *r = &reporting[i];
+        if (r->used && r->info.ep == ep && r->info.cluster_id == cluster && r->info.attr_id == attr) return r;
+    }
+    return NULL;
+}
+
+uint32_t host_zb_reports_for(uint16_t cluster_id, uint16_t attr_id)
+{
+    for (size_t i = 0; i < HOST_ZB_REPORTING; i++) {
+        if (reporting[i].used && reporting[i].info.cluster_id == cluster_id && reporting[i].info.attr_id == attr_id) {
+            return reporting[i].reports;
+        }
+    }
+    return 0;
+}
+
+int32_t host_zb_attribute(uint16_t cluster_id, uint16_t attr_id)
+{
+    for (size_t i = 0; i < HOST_ZB_ATTRS; i++) {
+        if (attrs[i].used && attrs[i].cluster == cluster_id && attrs[i].attr == attr_id) return attrs[i].value;
+    }
+    return 0;
+}
+
+static void host_zb_reporting_reset(void)
+{
+    memset(attrs, 0, sizeof(attrs));
+    memset(reporting, 0, sizeof(reporting));
+    host_zb_reports = 0;
+}
+
+esp_zb_zcl_status_t esp_zb_zcl_set_attribute_val(uint8_t endpoint, uint16_t cluster_id, uint8_t cluster_role,
+                                                 uint16_t attr_id, void *value_p, bool check)
+{
+    attr_store(endpoint, cluster_id, attr_id, value_p);
+    return ESP_ZB_ZCL_STATUS_SUCCESS;
+}
+
+esp_zb_zcl_status_t esp_zb_zcl_set_manufacturer_attribute_val(uint8_t endpoint, uint16_t cluster_id,
+                                                              uint8_t cluster_role, uint16_t manuf_code,
+                                                              uint16_t attr_id, void *value_p, bool check)
+{
+    return ESP_ZB_ZCL_STATUS_SUCCESS;
+}
+
+esp_zb_zcl_attr_t *esp_zb_zcl_get_attribute(uint8_t endpoint, uint16_t cluster_id, uint8_t cluster_role, uint16_t attr_id)
+{
+    return NULL;
+}
+
+// A new entry starts from the attribute's current value, as if it had just been reported; an
+// existing one takes the new intervals and change and keeps its last report
+esp_err_t esp_zb_zcl_update_reporting_info(esp_zb_zcl_reporting_info_t *report_info)
+{
+    host_zb_reporting_t *r = reporting_find(report_info->ep, report_info->cluster_id, report_info->attr_id);
+    if (r == NULL) {
+        for (size_t i = 0; i < HOST_ZB_REPORTING && r == NULL; i++) {
+            if (!reporting[i].used) r = &reporting[i];
+        }
+        if (r == NULL) return ESP_ERR_NO_MEM;
+        *r = (host_zb_reporting_t){
+            .used = true,
+            .reported = attr_value(report_info->ep, report_info->cluster_id, report_info->attr_id),
+            .last_report_us = host_time_us,
+        };
+    }
+    r->info = *report_info;
+    r->info.u.send_info.reported_value.s32 = r->reported;
+    reporting_kick();
+    return ESP_OK;
+}
+
+esp_zb_zcl_reporting_info_t *esp_zb_zcl_find_reporting_info(esp_zb_zcl_attr_location_info_t attr_info)
+{
+    host_zb_reporting_t *r = reporting_find(attr_info.endpoint_id, attr_info.cluster_id, attr_info.attr_id);
+    return r ? &r->info : NULL;
+}
+
+esp_err_t esp_zb_zcl_start_attr_reporting(esp_zb_zcl_attr_location_info_t attr_info) { return ESP_OK; }
+esp_err_t esp_zb_zcl_stop_attr_reporting(esp_zb_zcl_attr_location_info_t attr_info) { return ESP_OK; }
+
+// One-shot report: sent at once, whatever the configuration
+esp_err_t esp_zb_zcl_report_attr_cmd_req(esp_zb_zcl_report_attr_cmd_t *cmd_req)
+{
+    host_zb_reports++;
+    if (send_status_handler != NULL) {
+        esp_zb_zcl_command_send_status_message_t status = {.status = ESP_OK,
+                                                            .src_endpoint = cmd_req->zcl_basic_cmd.src_endpoint};
+        send_status_handler(status);
+    }
+    return ESP_OK;
+}
+
+void esp_zb_zcl_command_send_status_handler_register(esp_zb_zcl_command_send_status_callback_t cb)
+{
+    send_status_handler = cb;
+}
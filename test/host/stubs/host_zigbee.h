@@ -0,0 +1,44 @@
+#pragma once
+// Controls for the Zigbee stack fake in host_zigbee.c. esp_zb_task() runs as a task under the
+// task fake (host_fakes.h): the cluster and network calls are accepted and ignored, and
+// esp_zb_stack_main_loop() runs the scheduler alarms and a model of the attribute reporting
+// engine on the fake clock. Every report counts as sent and goes to the send-status callback. The tests play the
+// radio side by handing the registered callbacks what the stack would.
+#include "esp_zigbee_core.h"
+#include "zboss_api.h"
+
+// Call the core action callback the application registered, as the stack does for a received
+// command; ESP_ERR_INVALID_STATE before esp_zb_task() registered one
+esp_err_t host_zb_action(esp_zb_core_action_callback_id_t callback_id, const void *message);
+
+// Offer a received ZCL command to the raw command handler, with the payload after the ZCL header.
+// Returns the handler's answer: true if it consumed the command.
+bool host_zb_raw_command(const zb_zcl_parsed_hdr_t *header, const uint8_t *payload, size_t len);
+
+// What the application last asked the stack to commission with
+typedef struct {
+    uint32_t starts;                // esp_zb_bdb_start_top_level_commissioning() calls
+    uint8_t mode;                   // its last mode mask
+    uint32_t primary;               // channel sets and extended PAN ID last set
+    uint32_t secondary;
+    esp_zb_ieee_addr_t ext_pan_id;
+} host_zb_commissioning_t;
+
+extern host_zb_commissioning_t host_zb_commissioning;
+
+// Network the stack reports being on (esp_zb_get_current_channel, esp_zb_get_extended_pan_id)
+extern uint8_t host_zb_channel;
+extern esp_zb_ieee_addr_t host_zb_ext_pan_id;
+// On a network (esp_zb_bdb_dev_joined); false by default
+extern bool host_zb_joined;
+
+// Reports sent, automatic and one-shot, and the send times of the first HOST_ZB_REPORT_LOG
+#define HOST_ZB_REPORT_LOG 64
+extern uint32_t host_zb_reports;
+extern int64_t host_zb_report_log[HOST_ZB_REPORT_LOG];
+
+// Automatic reports of one attribute, and its current value as the stack holds it
+uint32_t host_zb_reports_for(uint16_t cluster_id, uint16_t attr_id);
+int32_t host_zb_attribute(uint16_t cluster_id, uint16_t attr_id);
+
+void host_zb_reset(void);
@@ -0,0 +1,6 @@
+#pragma once
+// Host stand-in: the values from the project sdkconfig the host builds need; the lamp options
+// are left at their defaults (end device, medium tables)
+#define CONFIG_IDF_TARGET   "esp32c6"
+#define CONFIG_ZB_ENABLED   1
+#define CONFIG_ZB_ZCZR      1
@@ -0,0 +1,24 @@
+#pragma once
+// Host stand-in for the ZBOSS internals zigbee_app.c reaches past the esp-zigbee API: the parsed
+// ZCL header and the payload of a raw command buffer. host_zigbee.c fills the one buffer there is.
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef unsigned int zb_uint_t;
+
+typedef struct {
+    uint16_t cluster_id;
+    uint8_t cmd_id;
+    bool is_common_command;
+    struct {
+        struct {
+            uint8_t dst_endpoint;
+        } common_data;
+    } addr_data;
+} zb_zcl_parsed_hdr_t;
+
+#define ZB_BUF_GET_PARAM(bufid, type) ((type *)host_zb_buf_param(bufid))
+
+void *host_zb_buf_param(uint8_t bufid);
+void *zb_buf_begin(uint8_t bufid);
+zb_uint_t zb_buf_len(uint8_t bufid);
@@ -0,0 +1,70 @@
+// Sigma-delta dither accumulator (tlc_dither.h): averages and pattern rate
+#include "host_test.h"
+#include "tlc_dither.h"
+
+// Every target averages to its quantised value and repeats within TLC_DITHER_STEPS frames
+static void test_all_targets(void)
+{
+    for (uint32_t target = 0; target <= 0xFFFF; target++) {
+        uint8_t error = 0;
+        uint8_t frames[2 * TLC_DITHER_STEPS];
+        uint32_t sum = 0;
+
+        for (int f = 0; f < 2 * TLC_DITHER_STEPS; f++) {
+            frames[f] = tlc_dither_step((uint16_t)target, &error);
+            if (f < TLC_DITHER_STEPS) sum += frames[f];
+            CHECK(error < (TLC_DITHER_STEPS > 1 ? TLC_DITHER_STEPS : 1));
+        }
+        for (int f = 0; f < TLC_DITHER_STEPS; f++) {
+            CHECK_EQ(frames[f + TLC_DITHER_STEPS], frames[f]);
+        }
+
+        // Off by at most half a sub-step from the exact target, except where the register saturates
+        double exact = target / 256.0 * TLC_DITHER_STEPS;
+        if (target <= 0xFF00) {
+            CHECK(sum >= exact - 0.5 && sum <= exact + 0.5);
+        } else {
+            CHECK_EQ(sum, 0xFF * TLC_DITHER_STEPS);
+        }
+        if (host_test_failures) {
+            printf("  at target 0x%04lx\n", (unsigned long)target);
+            return;
+        }
+    }
+}
+
+static void test_whole_steps(void)
+{
+    uint8_t error = 0;
+    for (int f = 0; f < 16; f++) CHECK_EQ(tlc_dither_step(0x1200, &error), 0x12);
+    CHECK_EQ(error, 0);
+}
+
+#if TLC_DITHER_STEPS == 4
+// 400 Hz refresh: quarter steps, so the slowest pattern is 100 Hz
+static void test_quarter_steps(void)
+{
+    static const struct { uint16_t target; const char *pattern; } cases[] = {
+        {0x0540, "5556"}, {0x0580, "5656"}, {0x05C0, "5666"},
+        {0x0510, "5555"},   // below an eighth: rounds down, no slow pattern
+        {0x05F0, "6666"},   // above seven eighths: rounds up
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        uint8_t error = 0;
+        char pattern[5] = {0};
+        for (int f = 0; f < 4; f++) pattern[f] = (char)('0' + tlc_dither_step(cases[i].target, &error));
+        for (int f = 0; f < 4; f++) CHECK_EQ(pattern[f], cases[i].pattern[f]);
+    }
+}
+#endif
+
+int main(void)
+{
+    printf("refresh %d Hz, %d sub-steps\n", TLC_DITHER_REFRESH_HZ, TLC_DITHER_STEPS);
+    test_whole_steps();
+    test_all_targets();
+#if TLC_DITHER_STEPS == 4
+    test_quarter_steps();
+#endif
+    return HOST_TEST_RESULT();
+}
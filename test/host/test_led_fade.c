@@ -0,0 +1,189 @@
+// Q8.8 fade engine (led_fade.c) on a fake clock, with the driver calls captured
+#include "host_test.h"
+#include "host_fakes.h"
+#include "led_fade.h"
+
+#define MS 1000LL
+
+static int frames;
+static uint16_t frame_level_q8;
+static uint16_t frame_mired;
+static int identify_starts;
+static int identify_stops;
+
+void led_apply_level_q8_and_ct(uint16_t level_q8, uint16_t mired)
+{
+    frames++;
+    frame_level_q8 = level_q8;
+    frame_mired = mired;
+}
+
+void tlc_identify_start(void) { identify_starts++; }
+void tlc_identify_stop(void) { identify_stops++; }
+
+// Tick at time t (ms) and return the rendered level, -1 if no frame was rendered
+static int tick_at(int64_t t_ms)
+{
+    host_time_us = t_ms * MS;
+    return led_fade_tick() ? frame_level_q8 : -1;
+}
+
+static void test_init_renders_once(void)
+{
+    host_time_us = 0;
+    led_fade_init(100, 300);
+    CHECK_EQ(tick_at(0), 100 << 8);
+    CHECK_EQ(frame_mired, 300);
+    CHECK_EQ(tick_at(10), -1);     // nothing running, nothing pending
+    CHECK(!led_fade_is_active());
+}
+
+static void test_linear_fade(void)
+{
+    host_time_us = 0;
+    led_fade_init(100, 300);
+    tick_at(0);
+
+    led_fade_set_level(200, 1000);
+    CHECK(led_fade_is_active());
+    CHECK_EQ(tick_at(0), 100 << 8);
+    CHECK_EQ(tick_at(250), 125 << 8);
+    CHECK_EQ(tick_at(500), 150 << 8);
+    CHECK_EQ(led_fade_get_level(), 150);
+    CHECK_EQ(tick_at(1000), 200 << 8);   // the end value gets its own frame
+    CHECK_EQ(tick_at(1010), -1);
+    CHECK_EQ(led_fade_get_level(), 200);
+    CHECK(!led_fade_is_active());
+}
+
+static void test_fraction_between_levels(void)
+{
+    host_time_us = 0;
+    led_fade_init(10, 300);
+    tick_at(0);
+
+    // One level over a second: the frames step through the fraction, not in a single jump
+    led_fade_set_level(11, 1000);
+    CHECK_EQ(tick_at(250), (10 << 8) + 64);
+    CHECK_EQ(tick_at(500), (10 << 8) + 128);
+    CHECK_EQ(tick_at(990), (10 << 8) + 253);
+    CHECK_EQ(led_fade_get_level(), 10);    // whole levels are truncated
+}
+
+static void test_retarget_mid_fade(void)
+{
+    host_time_us = 0;
+    led_fade_init(0, 300);
+    tick_at(0);
+
+    led_fade_set_level(254, 1000);
+    int mid = tick_at(500);
+    CHECK_EQ(mid, 127 << 8);
+
+    // A new target starts from where the light is, so there is no jump
+    led_fade_set_level(0, 1000);
+    CHECK_EQ(tick_at(500), mid);
+    CHECK_EQ(tick_at(1000), mid / 2);
+    CHECK_EQ(tick_at(1500), 0);
+}
+
+static void test_instant_and_mired(void)
+{
+    host_time_us = 0;
+    led_fade_init(50, 200);
+    tick_at(0);
+
+    led_fade_set_level(80, 0);
+    CHECK_EQ(tick_at(0), 80 << 8);
+
+    // Mired is rounded to whole steps for the CT table
+    led_fade_set_mired(204, 1000);
+    tick_at(125);
+    CHECK_EQ(frame_mired, 201);   // 200.5
+    tick_at(500);
+    CHECK_EQ(frame_mired, 202);
+    CHECK_EQ(led_fade_get_mired(), 202);
+}
+
+static void test_apply_target(void)
+{
+    host_time_us = 0;
+    led_fade_init(100, 300);
+    tick_at(0);
+
+    led_target_t target = {.level = 200, .mired = 300, .identify = false, .transition_ms = 1000};
+    led_fade_apply_target(&target);
+    tick_at(500);
+    CHECK_EQ(frame_level_q8, 150 << 8);
+
+    // Only the mired changed: the level fade carries on instead of restarting
+    target.mired = 400;
+    led_fade_apply_target(&target);
+    CHECK_EQ(tick_at(750), 175 << 8);
+
+    int starts = identify_starts;
+    int stops = identify_stops;
+    target.identify = true;
+    led_fade_apply_target(&target);
+    led_fade_apply_target(&target);
+    CHECK_EQ(identify_starts, starts + 1);
+
+    // Stopping identify re-renders the state the blink overwrote
+    host_time_us = 5000 * MS;
+    target.identify = false;
+    led_fade_apply_target(&target);
+    CHECK_EQ(identify_stops, stops + 1);
+    CHECK_EQ(tick_at(5000), 200 << 8);
+    CHECK_EQ(frame_mired, 400);
+}
+
+// A commanded 2.5 s transition rendered by led_task's frame tick: one frame every
+// LED_FADE_FRAME_MS with even steps, and the end value on time. The stack steps the attribute
+// meanwhile and republishes the same target, which must not restart the fade.
+static void test_frame_cadence(void)
+{
+    host_time_us = 0;
+    led_fade_init(100, 300);
+    led_target_t target = {.level = 100, .mired = 300, .transition_ms = 0};
+    led_fade_apply_target(&target);
+    tick_at(0);
+
+    target.level = 200;
+    target.transition_ms = 2500;
+    led_fade_apply_target(&target);
+
+    int rendered = 0;
+    int prev = -1;
+    int min_step = 0x7FFF, max_step = 0;
+    int64_t last_frame_ms = -1;
+    for (int64_t t = 0; t <= 3000; t += LED_FADE_FRAME_MS) {
+        if (t % 100 == 0) led_fade_apply_target(&target);   // stack steps CurrentLevel every 100 ms
+        int level = tick_at(t);
+        if (level < 0) continue;
+        rendered++;
+        if (prev >= 0) {
+            CHECK_EQ(t - last_frame_ms, LED_FADE_FRAME_MS);
+            if (level - prev < min_step) min_step = level - prev;
+            if (level - prev > max_step) max_step = level - prev;
+        }
+        prev = level;
+        last_frame_ms = t;
+    }
+    CHECK_EQ(rendered, 2500 / LED_FADE_FRAME_MS + 1);
+    CHECK_EQ(last_frame_ms, 2500);
+    CHECK_EQ(prev, 200 << 8);
+    // 100 levels in 250 frames: 0.4 level (102.4 in Q8.8) per frame
+    CHECK(min_step >= 102 && max_step <= 103);
+}
+
+int main(void)
+{
+    test_init_renders_once();
+    test_linear_fade();
+    test_fraction_between_levels();
+    test_retarget_mid_fade();
+    test_instant_and_mired();
+    test_apply_target();
+    test_frame_cadence();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,100 @@
+// Triple-buffer mailbox (led_mailbox.c): newest-wins semantics, then a producer and a consumer
+// thread hammering it to catch torn or out-of-order targets
+#include "host_test.h"
+#include "led_mailbox.h"
+#include <pthread.h>
+#include <sched.h>
+
+#define STRESS_PUBLISHES 2000000u
+
+// All fields derive from one sequence number, so a target mixed from two publishes shows up
+static led_target_t make_target(uint32_t seq)
+{
+    led_target_t t = {
+        .level = (uint8_t)seq,
+        .mired = (uint16_t)(seq >> 8),
+        .identify = (seq & 1) != 0,
+        .transition_ms = seq,
+    };
+    return t;
+}
+
+static bool target_consistent(const led_target_t *t)
+{
+    led_target_t expected = make_target(t->transition_ms);
+    return t->level == expected.level && t->mired == expected.mired && t->identify == expected.identify;
+}
+
+static void test_newest_wins(void)
+{
+    led_target_t out;
+    CHECK(!led_mailbox_take(&out));
+
+    led_target_t t = make_target(1);
+    led_mailbox_publish(&t);
+    CHECK(led_mailbox_take(&out));
+    CHECK_EQ(out.transition_ms, 1);
+    CHECK(!led_mailbox_take(&out));     // taken once only
+    CHECK_EQ(led_mailbox_get_dropped(), 0);
+
+    // A burst collapses to its last target; the others count as dropped
+    for (uint32_t seq = 2; seq <= 6; seq++) {
+        t = make_target(seq);
+        led_mailbox_publish(&t);
+    }
+    CHECK(led_mailbox_take(&out));
+    CHECK_EQ(out.transition_ms, 6);
+    CHECK(target_consistent(&out));
+    CHECK_EQ(led_mailbox_get_dropped(), 4);
+    CHECK(!led_mailbox_take(&out));
+}
+
+static void *producer(void *arg)
+{
+    uint32_t base = *(const uint32_t *)arg;
+    for (uint32_t seq = base; seq < base + STRESS_PUBLISHES; seq++) {
+        led_target_t t = make_target(seq);
+        led_mailbox_publish(&t);
+        if ((seq & 0xFF) == 0) sched_yield();   // let the consumer in on a single core too
+    }
+    return NULL;
+}
+
+static void test_concurrent(void)
+{
+    uint32_t base = 100;
+    uint32_t dropped_before = led_mailbox_get_dropped();
+    uint32_t taken = 0;
+    uint32_t last = 0;
+    uint32_t torn = 0;
+    uint32_t reordered = 0;
+    pthread_t thread;
+    led_target_t out;
+
+    CHECK_EQ(pthread_create(&thread, NULL, producer, &base), 0);
+    while (last != base + STRESS_PUBLISHES - 1) {
+        if (!led_mailbox_take(&out)) {
+            sched_yield();
+            continue;
+        }
+        taken++;
+        if (!target_consistent(&out)) torn++;
+        if (out.transition_ms <= last) reordered++;
+        last = out.transition_ms;
+    }
+    pthread_join(thread, NULL);
+
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(reordered, 0);
+    CHECK(!led_mailbox_take(&out));
+    // Every publish was either taken or overwritten
+    CHECK_EQ(taken + (led_mailbox_get_dropped() - dropped_before), STRESS_PUBLISHES);
+    printf("%u publishes, %u taken\n", STRESS_PUBLISHES, (unsigned)taken);
+}
+
+int main(void)
+{
+    test_newest_wins();
+    test_concurrent();
+    return HOST_TEST_RESULT();
+}
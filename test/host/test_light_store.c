@@ -0,0 +1,97 @@
+// Write-behind persistence of the light state (light_store.c) behind the real attribute callback,
+// with the flush task and the Zigbee task on the fake clock and NVS in RAM
+#include "host_test.h"
+#include "host_fakes.h"
+#include "host_zigbee.h"
+#include "zigbee_app.h"
+#include "light_store.h"
+#include "freertos/task.h"
+
+#define SLIDER_GAP_US   20000   // 50 updates per second while a slider is dragged
+
+static void set_level(uint8_t level)
+{
+    esp_zb_zcl_set_attr_value_message_t msg = {
+        .info = {.status = ESP_ZB_ZCL_STATUS_SUCCESS, .dst_endpoint = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT,
+                 .cluster = ESP_ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL},
+        .attribute = {.id = ESP_ZB_ZCL_ATTR_LEVEL_CONTROL_CURRENT_LEVEL_ID,
+                      .data = {ESP_ZB_ZCL_ATTR_TYPE_U8, 1, &level}},
+    };
+    CHECK_EQ(host_zb_action(ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID, &msg), ESP_OK);
+}
+
+// Run the tasks until until_us; returns when the first commit after the call happened, or -1
+static int64_t run_until(int64_t until_us)
+{
+    uint32_t commits = host_nvs_commits;
+    while (host_time_us < until_us) {
+        host_task_run(host_time_us + 1000);
+        if (host_nvs_commits != commits) return host_time_us;
+    }
+    return -1;
+}
+
+// A single change is committed once it has been quiet for LIGHT_STORE_QUIET_MS
+static void test_single_change(void)
+{
+    uint32_t commits = host_nvs_commits;
+    int64_t changed = host_time_us;
+    set_level(50);
+
+    int64_t committed = run_until(changed + 2 * LIGHT_STORE_QUIET_MS * 1000);
+    CHECK(committed >= changed + LIGHT_STORE_QUIET_MS * 1000);
+    CHECK(committed <= changed + (LIGHT_STORE_QUIET_MS + 2 * portTICK_PERIOD_MS) * 1000);
+    CHECK_EQ(host_nvs_commits - commits, 1);
+
+    // Setting the same value again is no change and writes nothing
+    set_level(50);
+    run_until(host_time_us + 2 * LIGHT_STORE_QUIET_MS * 1000);
+    CHECK_EQ(host_nvs_commits - commits, 1);
+}
+
+// A 10 s slider drag: 500 changes, at most two commits in the 10 s, the final level in flash
+static void test_slider_drag(void)
+{
+    light_store_stats_t before, after;
+    light_store_get_stats(&before);
+    uint32_t commits = host_nvs_commits;
+    int64_t start = host_time_us;
+
+    int n = 0;
+    while (host_time_us < start + 10 * 1000000) {
+        int step = n++ % 504;
+        set_level((uint8_t)(step < 253 ? 1 + step : 505 - step));
+        host_task_run(host_time_us + SLIDER_GAP_US);
+    }
+    uint8_t last_level = (uint8_t)current_brightness;
+    CHECK(host_nvs_commits - commits <= 2);
+    printf("slider drag: %d changes in 10 s, %lu commits\n", n, (unsigned long)(host_nvs_commits - commits));
+
+    // Once quiet, the last state goes to flash; still no more than two commits for the drag
+    host_task_run(host_time_us + (LIGHT_STORE_QUIET_MS + 100) * 1000);
+    light_store_get_stats(&after);
+    CHECK_EQ(after.updates - before.updates, n);
+    CHECK(host_nvs_commits - commits >= 1 && host_nvs_commits - commits <= 2);
+    CHECK_EQ(after.flushes - before.flushes, host_nvs_commits - commits);
+
+    // What was committed is the state the drag ended on
+    current_brightness = 0;
+    CHECK(LoadFromNVS());
+    CHECK_EQ(current_brightness, last_level);
+}
+
+int main(void)
+{
+    host_nvs_enabled = true;
+    host_nvs_reset();
+
+    // Start-up as app_main() does it: factory-new, nothing stored yet
+    CHECK(!LoadFromNVS());
+    light_store_start(false);
+    xTaskCreate(esp_zb_task, "Zigbee_main", 4096, NULL, 5, NULL);
+    host_task_run(host_time_us);
+
+    test_single_change();
+    test_slider_drag();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,228 @@
+// MS8607 PROM crc4 and pressure/temperature compensation (ms8607.c) against the datasheet example,
+// and the start/poll/collect sequence against the fake part on the fake clock
+#include "host_test.h"
+#include "host_fakes.h"
+#include "host_sensors.h"
+#include "ms8607.h"
+#include "boot_trace.h"
+#include "sensor_sched.h"
+
+// Firmware components ms8607.c calls, not reached by these tests
+void boot_trace_mark(boot_phase_t phase) {}
+esp_err_t sensor_register(const sensor_driver_t *driver) { return ESP_OK; }
+void sensor_publish(sensor_value_id_t id, int32_t value) {}
+
+// Datasheet example coefficients C1..C6 (word 0 is factory data and the CRC, word 7 unused)
+static const uint16_t datasheet_c[8] = {0, 46372, 43981, 29059, 27842, 31553, 28165, 0};
+
+// CRC-4 (x^4 + x + 1) as a plain polynomial division, independent of the table-free loop in
+// ms8607.c: words 0..6 MSB first with the CRC nibble cleared, followed by 12 zero bits
+static uint8_t reference_crc4(const uint16_t *words)
+{
+    uint8_t rem = 0;
+    for (int bit = 0; bit < 7 * 16 + 12; bit++) {
+        int word = bit / 16;
+        uint16_t value = word < 7 ? words[word] : 0;
+        if (word == 0) value &= 0x0FFF;
+        rem = (uint8_t)((rem << 1) | ((value >> (15 - bit % 16)) & 1));
+        if (rem & 0x10) rem ^= 0x13;
+    }
+    return rem;
+}
+
+static void with_crc(uint16_t *words)
+{
+    words[0] = (uint16_t)((words[0] & 0x0FFF) | (reference_crc4(words) << 12));
+}
+
+static void test_crc4(void)
+{
+    uint16_t words[8];
+    for (int i = 0; i < 8; i++) words[i] = datasheet_c[i];
+    words[0] = 0x00B0;
+    with_crc(words);
+    CHECK(ms8607_prom_valid(words));
+
+    // Every single-bit error in words 0..6 is caught, including in the CRC itself
+    int missed = 0;
+    for (int word = 0; word < 7; word++) {
+        for (int bit = 0; bit < 16; bit++) {
+            words[word] ^= (uint16_t)(1u << bit);
+            if (ms8607_prom_valid(words)) missed++;
+            words[word] ^= (uint16_t)(1u << bit);
+        }
+    }
+    CHECK_EQ(missed, 0);
+
+    // Word 7 does not exist on the MS8607 and is not covered
+    words[7] = 0x1234;
+    CHECK(ms8607_prom_valid(words));
+    words[7] = 0;
+
+    // A bus returning all ones (nobody answering) must not pass. All zeros does: its CRC is 0.
+    uint16_t ones[8] = {0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0};
+    CHECK(!ms8607_prom_valid(ones));
+
+    // Random PROMs agree with the reference for every CRC nibble
+    uint32_t seed = 1;
+    int mismatches = 0;
+    for (int n = 0; n < 1000; n++) {
+        for (int i = 0; i < 7; i++) {
+            seed = seed * 1103515245u + 12345u;
+            words[i] = (uint16_t)(seed >> 16);
+        }
+        bool expected = reference_crc4(words) == (words[0] >> 12);
+        if (ms8607_prom_valid(words) != expected) mismatches++;
+        with_crc(words);
+        if (!ms8607_prom_valid(words)) mismatches++;
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+static void test_compensation_datasheet(void)
+{
+    int32_t temperature, pressure;
+    ms8607_compensate_pt(datasheet_c, 6465444, 8077636, &temperature, &pressure);
+    CHECK_EQ(temperature, 2000);     // 20.00 C
+    CHECK_EQ(pressure, 110002);      // 1100.02 mbar
+}
+
+// Below 20 C and below -15 C the second-order terms apply; check against the datasheet formulas
+// evaluated in floating point
+static void test_compensation_low_temperature(void)
+{
+    static const uint32_t d2_values[] = {7900000, 7500000, 7000000};
+    for (size_t i = 0; i < sizeof(d2_values) / sizeof(d2_values[0]); i++) {
+        uint32_t d1 = 6465444;
+        uint32_t d2 = d2_values[i];
+        int32_t temperature, pressure;
+        ms8607_compensate_pt(datasheet_c, d1, d2, &temperature, &pressure);
+
+        const uint16_t *c = datasheet_c;
+        double dT = (double)d2 - c[5] * 256.0;
+        double temp = 2000 + dT * c[6] / 8388608.0;
+        double off = c[2] * 131072.0 + c[4] * dT / 64.0;
+        double sens = c[1] * 65536.0 + c[3] * dT / 128.0;
+        double low = (temp - 2000) * (temp - 2000);
+        double t2 = 3 * dT * dT / 8589934592.0;
+        double off2 = 61 * low / 16;
+        double sens2 = 29 * low / 16;
+        if (temp < -1500) {
+            off2 += 17 * (temp + 1500) * (temp + 1500);
+            sens2 += 9 * (temp + 1500) * (temp + 1500);
+        }
+        double expected_t = temp - t2;
+        double expected_p = (d1 * (sens - sens2) / 2097152.0 - (off - off2)) / 32768.0;
+
+        CHECK(temperature < 2000);
+        CHECK(temperature - expected_t > -2 && temperature - expected_t < 2);
+        CHECK(pressure - expected_p > -2 && pressure - expected_p < 2);
+    }
+}
+
+static void test_compensation_humidity(void)
+{
+    CHECK_EQ(ms8607_compensate_rh(0x0000, 2000), 0);          // clamped at 0 %RH
+    CHECK_EQ(ms8607_compensate_rh(0xFFFF, 2000), 10000);      // clamped at 100 %RH
+    CHECK_EQ(ms8607_compensate_rh(0x8000, 2000), 5650);       // -6 + 125 / 2
+    CHECK_EQ(ms8607_compensate_rh(0x8003, 2000), 5650);       // status bits ignored
+    CHECK_EQ(ms8607_compensate_rh(0x8000, 3000), 5650 + 180); // (20 - T) * -0.18 %RH
+}
+
+static host_ms8607_t part = {.d1 = 6465444, .d2 = 8077636, .rh_raw = 0x8000};
+
+// Poll as the scheduler does; checks the time it is told to wait against the part
+static uint32_t poll_remaining(esp_err_t expected)
+{
+    uint32_t remaining_us = UINT32_MAX;
+    CHECK_EQ(ms8607_poll(&remaining_us), expected);
+    return remaining_us;
+}
+
+// One sample: D2 and RH convert together, D1 follows D2 on the one PT ADC. The sample is ready
+// after the longer of 2 x PT and RH, plus the bus time of the handover, never after their sum.
+static void sample(ms8607_osr_t osr, ms8607_rh_res_t rh_res, uint32_t pt_us, uint32_t rh_us)
+{
+    ms8607_set_resolution(osr, rh_res);
+    uint32_t early_reads = part.pt_early_reads, nacks = part.rh_nacks;
+    int64_t start = host_time_us;
+    CHECK_EQ(ms8607_start(), ESP_OK);
+    int64_t started = host_time_us;
+    CHECK_EQ(part.rh_conv_end_us - host_time_us, rh_us);
+
+    // Converting D2: the next wake-up is the handover, not the end of the sample
+    CHECK_EQ(poll_remaining(ESP_ERR_NOT_FINISHED), part.pt_conv_end_us - host_time_us);
+    host_time_us = part.pt_conv_end_us - 1;
+    CHECK_EQ(poll_remaining(ESP_ERR_NOT_FINISHED), 1);
+    ms8607_reading_t r;
+    CHECK_EQ(ms8607_collect(&r), ESP_ERR_NOT_FINISHED);
+
+    // D2 due: the same poll reads it and starts D1
+    host_time_us = part.pt_conv_end_us;
+    uint32_t conversions = part.pt_conversions;
+    uint32_t remaining = poll_remaining(ESP_ERR_NOT_FINISHED);
+    CHECK_EQ(part.pt_conversions, conversions + 1);
+    CHECK_EQ(part.pt_conv_end_us - host_time_us, pt_us);
+    int64_t due = part.pt_conv_end_us > part.rh_conv_end_us ? part.pt_conv_end_us : part.rh_conv_end_us;
+    CHECK_EQ(remaining, due - host_time_us);
+
+    // Not before the later of the two
+    host_time_us = due - 1;
+    CHECK_EQ(poll_remaining(ESP_ERR_NOT_FINISHED), 1);
+    CHECK_EQ(ms8607_collect(&r), ESP_ERR_NOT_FINISHED);
+    host_time_us = due;
+    CHECK_EQ(poll_remaining(ESP_OK), 0);
+    CHECK_EQ(ms8607_collect(&r), ESP_OK);
+    CHECK_EQ(r.temperature, 2000);
+    CHECK_EQ(r.pressure, 110002);
+    CHECK_EQ(r.humidity, 5650);
+
+    // Neither die was read early, and nothing was left converting
+    CHECK_EQ(part.pt_early_reads, early_reads);
+    CHECK_EQ(part.rh_nacks, nacks);
+    CHECK_EQ(ms8607_poll(NULL), ESP_ERR_INVALID_STATE);
+
+    ms8607_stats_t stats;
+    ms8607_get_stats(&stats);
+    uint32_t window = 2 * pt_us > rh_us ? 2 * pt_us : rh_us;
+    CHECK_EQ(stats.last_conv_us, window);
+    CHECK(due - started >= window);
+    CHECK(due - started <= window + stats.last_bus_us);
+    CHECK(due - started < 2 * pt_us + rh_us);
+    printf("OSR %d, RH mode %d: ready %lld us after start (2 x PT %lu, RH %lu, sum %lu), %lu us on the bus\n",
+           256 << osr, rh_res, (long long)(due - start), (unsigned long)(2 * pt_us), (unsigned long)rh_us,
+           (unsigned long)(2 * pt_us + rh_us), (unsigned long)stats.last_bus_us);
+}
+
+static void test_sampling(void)
+{
+    uint16_t words[8];
+    for (int i = 0; i < 8; i++) words[i] = datasheet_c[i];
+    words[0] = 0x00B0;
+    with_crc(words);
+    for (int i = 0; i < 8; i++) part.prom[i] = words[i];
+
+    host_i2c_clocked = true;
+    host_ms8607_attach(&part);
+    CHECK_EQ(ms8607_init(NULL), ESP_OK);
+
+    // Nothing converting yet
+    CHECK_EQ(ms8607_poll(NULL), ESP_ERR_INVALID_STATE);
+
+    // PT bound: 2 x 9.04 ms against 16 ms of RH
+    sample(MS8607_OSR_4096, MS8607_RH_12BIT, 9040, 16000);
+    // RH bound: 2 x 2.28 ms against 16 ms
+    sample(MS8607_OSR_1024, MS8607_RH_12BIT, 2280, 16000);
+    // The adaptive fast mode: 2 x 2.28 ms against 5 ms
+    sample(MS8607_FAST_OSR, MS8607_FAST_RH, 2280, 5000);
+}
+
+int main(void)
+{
+    test_crc4();
+    test_compensation_datasheet();
+    test_compensation_low_temperature();
+    test_compensation_humidity();
+    test_sampling();
+    return HOST_TEST_RESULT();
+}
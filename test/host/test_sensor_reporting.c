@@ -0,0 +1,119 @@
+// Temperature reporting frames for an hour of slowly drifting readings: the sensor table copied
+// into the measurement cluster by zigbee_publish_sensors() and reported by the engine, against
+// the one-shot report per reading the firmware sent before
+#include "host_test.h"
+#include "host_fakes.h"
+#include "host_zigbee.h"
+#include "zigbee_app.h"
+#include "light_store.h"
+#include "sensor_sched.h"
+#include "freertos/task.h"
+
+#define TC74_PERIOD_MS   2000
+#define HOUR_US          (3600 * 1000000LL)
+
+#define TEMP_CLUSTER     ESP_ZB_ZCL_CLUSTER_ID_TEMP_MEASUREMENT
+#define TEMP_ATTR        ESP_ZB_ZCL_ATTR_TEMP_MEASUREMENT_VALUE_ID
+
+// 20.5 C rising by one degree an hour, read in the TC74's whole degrees (0.01 C units)
+static int32_t tc74_reading(int64_t now_us)
+{
+    int32_t centi = 2050 + (int32_t)(now_us * 100 / HOUR_US);
+    return centi / 100 * 100;
+}
+
+static bool legacy;             // publish as the firmware did before: a one-shot report per reading
+static uint32_t one_shots;
+
+// The TC74 sampling slot: the latest reading into the sensor table, every TC74_PERIOD_MS
+static void tc74_task(void *arg)
+{
+    int64_t start = host_time_us;
+    while (1) {
+        int32_t reading = tc74_reading(host_time_us - start);
+        sensor_publish(SENSOR_TC74_TEMPERATURE, reading);
+        if (legacy) {
+            int16_t value = (int16_t)reading;
+            esp_zb_zcl_set_attribute_val(HA_COLOR_DIMMABLE_LIGHT_ENDPOINT, TEMP_CLUSTER, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                         TEMP_ATTR, &value, false);
+            esp_zb_zcl_report_attr_cmd_t cmd = {
+                .zcl_basic_cmd.src_endpoint = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT,
+                .zcl_basic_cmd.dst_endpoint = 1,
+                .address_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+                .direction = ESP_ZB_ZCL_CMD_DIRECTION_TO_CLI,
+                .clusterID = TEMP_CLUSTER,
+                .attributeID = TEMP_ATTR,
+            };
+            if (esp_zb_zcl_report_attr_cmd_req(&cmd) == ESP_OK) one_shots++;
+        }
+        vTaskDelay(pdMS_TO_TICKS(TC74_PERIOD_MS));
+    }
+}
+
+static esp_zb_zcl_attr_location_info_t temp_location(void)
+{
+    esp_zb_zcl_attr_location_info_t location = {
+        .endpoint_id = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT,
+        .cluster_id = TEMP_CLUSTER,
+        .cluster_role = ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        .manuf_code = ESP_ZB_ZCL_ATTR_NON_MANUFACTURER_SPECIFIC,
+        .attr_id = TEMP_ATTR,
+    };
+    return location;
+}
+
+// Now: readings go through the sensor table and the reporting engine decides
+static uint32_t frames_now(void)
+{
+    uint32_t reports = host_zb_reports_for(TEMP_CLUSTER, TEMP_ATTR);
+    host_task_run(host_time_us + HOUR_US);
+    uint32_t frames = host_zb_reports_for(TEMP_CLUSTER, TEMP_ATTR) - reports;
+
+    // Start-up report, the one-degree step, heartbeats at TEMP_REPORT_MAX_S in between
+    CHECK(frames >= HOUR_US / (TEMP_REPORT_MAX_S * 1000000LL));
+    CHECK(frames <= HOUR_US / (TEMP_REPORT_MAX_S * 1000000LL) + 2);
+    CHECK_EQ(esp_zb_zcl_find_reporting_info(temp_location())->u.send_info.reported_value.s16, 2100);
+    return frames;
+}
+
+// Before: a one-shot report per reading, and the entry as it was configured (min 2 s, max 10 s,
+// any change), registered with the receive direction so the engine never sent from it
+static uint32_t frames_before(void)
+{
+    esp_zb_zcl_reporting_info_t old = *esp_zb_zcl_find_reporting_info(temp_location());
+    old.direction = ESP_ZB_ZCL_CMD_DIRECTION_TO_CLI;
+    old.u.send_info.min_interval = 2;
+    old.u.send_info.max_interval = 10;
+    old.u.send_info.delta.u16 = 0;
+    CHECK_EQ(esp_zb_zcl_update_reporting_info(&old), ESP_OK);
+
+    legacy = true;
+    uint32_t reports = host_zb_reports_for(TEMP_CLUSTER, TEMP_ATTR);
+    uint32_t shots = one_shots;
+    host_task_run(host_time_us + HOUR_US);
+    legacy = false;
+
+    CHECK_EQ(host_zb_reports_for(TEMP_CLUSTER, TEMP_ATTR), reports);
+    return one_shots - shots;
+}
+
+int main(void)
+{
+    light_store_start(false);
+    host_zb_joined = true;
+    xTaskCreate(esp_zb_task, "Zigbee_main", 4096, NULL, 5, NULL);
+    host_task_run(host_time_us + 100000);
+
+    // Joined: the stack's steering signal starts copying the sensor table into the clusters
+    uint32_t signal = ESP_ZB_BDB_SIGNAL_STEERING;
+    esp_zb_app_signal_t joined = {.p_app_signal = &signal, .esp_err_status = ESP_OK};
+    esp_zb_app_signal_handler(&joined);
+    xTaskCreate(tc74_task, "sensors", SENSOR_TASK_STACK, NULL, 4, NULL);
+
+    uint32_t now = frames_now();
+    uint32_t before = frames_before();
+    CHECK_EQ(before, HOUR_US / (TC74_PERIOD_MS * 1000LL));
+    printf("temperature drifting 1 C/h, read every %d s: %lu frames/hour before, %lu now\n", TC74_PERIOD_MS / 1000,
+           (unsigned long)before, (unsigned long)now);
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,121 @@
+// The sensor scheduler (sensor_sched.c) with the real TC74 and MS8607 drivers on the fake bus and
+// a synthetic 250 ms sensor, run on the fake clock with the 100 Hz tick: every slot sampled on its
+// grid, no deadline missed, and the worst start-to-result latency of each sensor within bounds
+#include "host_test.h"
+#include "host_fakes.h"
+#include "host_sensors.h"
+#include "sensor_sched.h"
+#include "boot_trace.h"
+#include "tc74.h"
+#include "ms8607.h"
+#include "freertos/task.h"
+
+void boot_trace_mark(boot_phase_t phase) {}
+
+#define RUN_US          (10 * 60 * 1000000LL)
+#define TICK_US         (portTICK_PERIOD_MS * 1000)
+
+// A fast sensor with a conversion to wait for: 4.5 ms every 250 ms
+#define FAST_PERIOD_MS  250
+#define FAST_CONV_US    4500
+#define FAST_DEADLINE_MS 30
+
+static int64_t fast_due_us;
+static uint32_t fast_early_reads;
+
+static esp_err_t fast_start(void *ctx)
+{
+    fast_due_us = host_time_us + FAST_CONV_US;
+    return ESP_OK;
+}
+
+static esp_err_t fast_poll(void *ctx, uint32_t *remaining_us)
+{
+    int64_t left = fast_due_us - host_time_us;
+    *remaining_us = left > 0 ? (uint32_t)left : 0;
+    return left > 0 ? ESP_ERR_NOT_FINISHED : ESP_OK;
+}
+
+static esp_err_t fast_read(void *ctx)
+{
+    if (host_time_us < fast_due_us) fast_early_reads++;
+    return ESP_OK;
+}
+
+static host_tc74_t tc74 = {.temperature = 23, .config = 0x80};
+static host_ms8607_t ms8607 = {.d1 = 6465444, .d2 = 8077636, .rh_raw = 0x8000};
+
+// Datasheet example coefficients C1..C6; word 0 gets the CRC over words 0..6
+static const uint16_t datasheet_prom[8] = {0x00B0, 46372, 43981, 29059, 27842, 31553, 28165, 0};
+
+static void check_sensor(int index, const char *name, uint32_t period_ms, uint32_t min_latency_us,
+                         uint32_t max_latency_us)
+{
+    sensor_stats_t stats;
+    CHECK(sensor_get_stats(index, &stats));
+    printf("%-7s %5lu samples, %lu errors, %lu deadline misses, %lu skipped, worst latency %lu us\n", name,
+           (unsigned long)stats.samples, (unsigned long)stats.errors, (unsigned long)stats.deadline_misses,
+           (unsigned long)stats.skipped, (unsigned long)stats.max_latency_us);
+
+    CHECK(stats.enabled);
+    uint32_t slots = (uint32_t)(RUN_US / (period_ms * 1000LL));
+    CHECK(stats.samples >= slots - 1 && stats.samples <= slots);
+    CHECK_EQ(stats.errors, 0);
+    CHECK_EQ(stats.deadline_misses, 0);
+    CHECK_EQ(stats.skipped, 0);
+    CHECK(stats.max_latency_us >= min_latency_us);
+    CHECK(stats.max_latency_us <= max_latency_us);
+}
+
+int main(void)
+{
+    for (int i = 0; i < 8; i++) ms8607.prom[i] = datasheet_prom[i];
+    while (!ms8607_prom_valid(ms8607.prom)) ms8607.prom[0] += 0x1000;
+    host_i2c_clocked = true;
+    host_tc74_attach(&tc74);
+    host_ms8607_attach(&ms8607);
+
+    CHECK_EQ(tc74_sensor_register(NULL), ESP_OK);
+    CHECK_EQ(ms8607_sensor_register(NULL), ESP_OK);
+    const sensor_driver_t fast = {
+        .name = "fast",
+        .start = fast_start,
+        .poll = fast_poll,
+        .read = fast_read,
+        .period_ms = FAST_PERIOD_MS,
+        .deadline_ms = FAST_DEADLINE_MS,
+    };
+    CHECK_EQ(sensor_register(&fast), ESP_OK);
+    CHECK_EQ(sensor_sched_start(), ESP_OK);
+
+    int64_t start = host_time_us;
+    host_task_run(start + RUN_US);
+
+    // TC74: one register read, served first in its pass
+    check_sensor(0, "tc74", TC74_SAMPLE_PERIOD_MS, 0, 1000);
+    // MS8607: never before 2 x 9.04 ms of PT at full resolution; each of the two waits (the
+    // D2 to D1 handover, the end of the sample) rounds up to the next tick
+    ms8607_stats_t ms;
+    ms8607_get_stats(&ms);
+    check_sensor(1, "ms8607", MS8607_SAMPLE_PERIOD_MS, 2 * 9040, 2 * 9040 + 2 * TICK_US + 5000);
+    // The fast sensor: its conversion rounded up to the tick, plus the bus time of the sensors
+    // served before it in the same pass
+    check_sensor(2, "fast", FAST_PERIOD_MS, FAST_CONV_US, FAST_CONV_US + TICK_US + 5000);
+
+    // No result was collected before it was ready
+    CHECK_EQ(tc74.unsettled_reads, 0);
+    CHECK_EQ(ms8607.pt_early_reads, 0);
+    CHECK_EQ(ms8607.rh_nacks, 0);
+    CHECK_EQ(fast_early_reads, 0);
+
+    int32_t value;
+    CHECK(sensor_get(SENSOR_TC74_TEMPERATURE, &value, NULL));
+    CHECK_EQ(value, 2300);
+    CHECK(sensor_get(SENSOR_MS8607_PRESSURE, &value, NULL));
+    CHECK_EQ(value, 110002);
+    CHECK(sensor_get(SENSOR_MS8607_TEMPERATURE, &value, NULL));
+    CHECK_EQ(value, 2000);
+    printf("MS8607: %lu of %lu samples in the fast mode\n", (unsigned long)ms.fast_samples,
+           (unsigned long)ms.samples);
+    return HOST_TEST_RESULT();
+}
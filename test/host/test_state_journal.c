@@ -0,0 +1,171 @@
+// Append-only state journal (state_journal.c) on a RAM-backed NOR partition: record round trip,
+// wrap-around, and recovery from torn writes and interrupted erases at mount
+#include "host_test.h"
+#include "host_fakes.h"
+#include "state_journal.h"
+#include <string.h>
+
+#define SECTORS          2
+#define SLOTS_PER_SECTOR (HOST_FLASH_SECTOR / STATE_JOURNAL_RECORD_SIZE)
+#define SLOTS            (SECTORS * SLOTS_PER_SECTOR)
+
+typedef struct {
+    uint32_t n;
+    uint8_t tag[8];
+} payload_t;
+
+static payload_t payload(uint32_t n)
+{
+    payload_t p = {.n = n};
+    memset(p.tag, (int)(n & 0xFF), sizeof(p.tag));
+    return p;
+}
+
+static void format(uint8_t fill)
+{
+    host_flash_size = SECTORS * HOST_FLASH_SECTOR;
+    memset(host_flash, fill, host_flash_size);
+    host_flash_bad_writes = 0;
+    host_flash_fail_writes = 0;
+}
+
+static void append(uint32_t n)
+{
+    payload_t p = payload(n);
+    CHECK_EQ(state_journal_append(&p, sizeof(p)), ESP_OK);
+}
+
+// Remount and return the newest payload's n, 0 if the journal is empty
+static uint32_t mount_latest(void)
+{
+    CHECK_EQ(state_journal_init(), ESP_OK);
+    payload_t p;
+    size_t len = sizeof(p);
+    esp_err_t err = state_journal_read_latest(&p, &len);
+    if (err == ESP_ERR_NOT_FOUND) return 0;
+    CHECK_EQ(err, ESP_OK);
+    CHECK_EQ(len, sizeof(p));
+    payload_t expected = payload(p.n);
+    CHECK(memcmp(&p, &expected, sizeof(p)) == 0);
+    return p.n;
+}
+
+static void test_no_partition(void)
+{
+    host_flash_size = 0;
+    CHECK_EQ(state_journal_init(), ESP_ERR_NOT_FOUND);
+    CHECK(!state_journal_is_mounted());
+    payload_t p = payload(1);
+    CHECK_EQ(state_journal_append(&p, sizeof(p)), ESP_ERR_INVALID_STATE);
+}
+
+static void test_round_trip(void)
+{
+    format(0xFF);
+    CHECK_EQ(mount_latest(), 0);
+    CHECK(state_journal_is_mounted());
+
+    append(1);
+    append(2);
+    CHECK_EQ(mount_latest(), 2);
+    append(3);                        // continues after the remount, not over record 2
+    CHECK_EQ(mount_latest(), 3);
+
+    uint8_t big[STATE_JOURNAL_PAYLOAD_SIZE + 1] = {0};
+    CHECK_EQ(state_journal_append(big, sizeof(big)), ESP_ERR_INVALID_SIZE);
+
+    payload_t p;
+    size_t small = sizeof(p) - 1;
+    CHECK_EQ(state_journal_read_latest(&p, &small), ESP_ERR_INVALID_SIZE);
+    CHECK_EQ(host_flash_bad_writes, 0);
+}
+
+// Garbage in a never-used partition must not come back as state
+static void test_unformatted(void)
+{
+    format(0x00);
+    CHECK_EQ(mount_latest(), 0);
+    append(1);
+    CHECK_EQ(mount_latest(), 1);
+    CHECK_EQ(host_flash_bad_writes, 0);
+}
+
+static void test_wrap(void)
+{
+    format(0xFF);
+    CHECK_EQ(mount_latest(), 0);
+
+    uint32_t erases = host_flash_erases;
+    for (uint32_t n = 1; n <= 2 * SLOTS + 10; n++) append(n);
+    CHECK_EQ(mount_latest(), 2 * SLOTS + 10);
+    // One erase per sector entered: slots 0, 128, 0, 128, 0 (the last at record 2 * SLOTS + 1)
+    CHECK_EQ(host_flash_erases - erases, 5);
+    CHECK_EQ(host_flash_bad_writes, 0);
+
+    state_journal_stats_t stats;
+    state_journal_get_stats(&stats);
+    CHECK_EQ(stats.sequence, 2 * SLOTS + 10);
+}
+
+// Power lost while programming: the torn record is ignored and its slot is not reused
+static void test_torn_write(void)
+{
+    format(0xFF);
+    CHECK_EQ(mount_latest(), 0);
+    for (uint32_t n = 1; n <= 5; n++) append(n);
+
+    // Record 5 sits in slot 4; clear some bits of its payload as a half-done program would
+    host_flash[4 * STATE_JOURNAL_RECORD_SIZE + 12] &= 0xF0;
+    CHECK_EQ(mount_latest(), 4);
+
+    append(6);
+    CHECK_EQ(mount_latest(), 6);
+    CHECK_EQ(host_flash_bad_writes, 0);
+
+    // A failed write also consumes its slot and leaves the previous record current
+    host_flash_fail_writes = 1;
+    payload_t p = payload(7);
+    CHECK(state_journal_append(&p, sizeof(p)) != ESP_OK);
+    append(8);
+    CHECK_EQ(mount_latest(), 8);
+}
+
+// Power lost while erasing the sector the head just entered: part of it is erased, part still
+// holds old records. The newest record in the other sector wins, and the next append erases
+// the sector again.
+static void test_interrupted_erase(void)
+{
+    format(0xFF);
+    CHECK_EQ(mount_latest(), 0);
+    for (uint32_t n = 1; n <= SLOTS; n++) append(n);   // both sectors full, head back at slot 0
+
+    memset(host_flash, 0xFF, HOST_FLASH_SECTOR / 2);   // first half of sector 0 erased
+    CHECK_EQ(mount_latest(), SLOTS);
+
+    uint32_t erases = host_flash_erases;
+    append(SLOTS + 1);
+    CHECK_EQ(host_flash_erases - erases, 1);
+    CHECK_EQ(mount_latest(), SLOTS + 1);
+    CHECK_EQ(host_flash_bad_writes, 0);
+
+    // Torn at the very start of a sector: the newest valid record is the last of the other one
+    format(0xFF);
+    CHECK_EQ(mount_latest(), 0);
+    for (uint32_t n = 1; n <= SLOTS_PER_SECTOR + 1; n++) append(n);
+    host_flash[SLOTS_PER_SECTOR * STATE_JOURNAL_RECORD_SIZE] ^= 0x01;
+    CHECK_EQ(mount_latest(), SLOTS_PER_SECTOR);
+    append(SLOTS_PER_SECTOR + 2);
+    CHECK_EQ(mount_latest(), SLOTS_PER_SECTOR + 2);
+    CHECK_EQ(host_flash_bad_writes, 0);
+}
+
+int main(void)
+{
+    test_no_partition();
+    test_round_trip();
+    test_unformatted();
+    test_wrap();
+    test_torn_write();
+    test_interrupted_erase();
+    return HOST_TEST_RESULT();
+}
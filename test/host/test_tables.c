@@ -0,0 +1,60 @@
+// Generated CT mix and level curves (gen_tables.py) against the formulas they encode
+#include "host_test.h"
+#include "tlc59108_tables.h"
+#include <math.h>
+
+#define KELVIN_WARM 2200.0
+#define KELVIN_COOL 5000.0
+
+static double cie1931(int level)
+{
+    double lightness = 100.0 * level / LEVEL_MAX;
+    if (lightness <= 8.0) return lightness / 903.3;
+    return pow((lightness + 16.0) / 116.0, 3.0);
+}
+
+static void check_curve(const uint16_t *table, double (*curve)(int))
+{
+    CHECK_EQ(table[0], 0);
+    CHECK_EQ(table[LEVEL_MAX], INTENSITY_MAX);
+    for (int level = 1; level <= LEVEL_MAX; level++) {
+        CHECK(table[level] >= table[level - 1]);
+        CHECK(fabs(table[level] - curve(level) * INTENSITY_MAX) <= 0.5);
+    }
+}
+
+static double linear(int level) { return (double)level / LEVEL_MAX; }
+static double gamma22(int level) { return pow((double)level / LEVEL_MAX, 2.2); }
+
+static void test_ct_mix(void)
+{
+    CHECK_EQ(sizeof(ct_white_q15) / sizeof(ct_white_q15[0]), CT_MIRED_MAX - CT_MIRED_MIN + 1);
+    CHECK_EQ(ct_white_q15[0], CT_Q15_ONE);                           // 200 mired = 5000 K, all white
+    CHECK_EQ(ct_white_q15[CT_MIRED_MAX - CT_MIRED_MIN], 0);         // clamped to 2200 K, all amber
+
+    for (int mired = CT_MIRED_MIN; mired <= CT_MIRED_MAX; mired++) {
+        int i = mired - CT_MIRED_MIN;
+        double kelvin = fmin(fmax(1e6 / mired, KELVIN_WARM), KELVIN_COOL);
+        double expected = (kelvin - KELVIN_WARM) / (KELVIN_COOL - KELVIN_WARM) * CT_Q15_ONE;
+        CHECK(fabs(ct_white_q15[i] - expected) <= 0.5);
+        if (i > 0) CHECK(ct_white_q15[i] <= ct_white_q15[i - 1]);   // warmer never gets whiter
+    }
+}
+
+static void test_level_curves(void)
+{
+    check_curve(level_linear_u16, linear);
+    check_curve(level_cie1931_u16, cie1931);
+    check_curve(level_gamma22_u16, gamma22);
+
+    // The perceptual curves keep the lowest levels lit but far below linear
+    CHECK(level_cie1931_u16[1] > 0);
+    CHECK(level_cie1931_u16[1] < level_linear_u16[1]);
+}
+
+int main(void)
+{
+    test_ct_mix();
+    test_level_curves();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,362 @@
+// TLC59108 driver (tlc59108.c) against a register-level fake of the chip on the fake I2C bus
+#include "host_test.h"
+#include "host_fakes.h"
+#include "tlc59108.h"
+#include "boot_trace.h"
+#include "driver/i2c_master.h"
+#include <string.h>
+
+void boot_trace_mark(boot_phase_t phase) {}
+
+#define TLC_ADDR    0x41
+#define REG_PWM0    0x02
+#define REG_GRPPWM  0x0A
+#define NUM_REGS    0x12   // MODE1 .. ALLCALLADR
+
+// The chip: a control byte selects the register and the auto-increment mode, data bytes follow
+typedef struct {
+    host_i2c_device_t dev;
+    uint8_t regs[NUM_REGS];
+    uint8_t pointer;
+    uint32_t pwm_writes;   // data bytes that landed in PWM0..PWM7
+} fake_tlc_t;
+
+static esp_err_t fake_tlc_write(host_i2c_device_t *dev, const uint8_t *data, size_t len)
+{
+    fake_tlc_t *tlc = dev->ctx;
+    uint8_t reg = data[0] & 0x1F;
+    bool increment = (data[0] & 0x80) != 0;
+
+    if (reg >= NUM_REGS) return ESP_FAIL;
+    for (size_t i = 1; i < len; i++) {
+        tlc->regs[reg] = data[i];
+        if (reg >= REG_PWM0 && reg < REG_PWM0 + TLC_NUM_CHANNELS) tlc->pwm_writes++;
+        if (increment) reg = (reg + 1) % NUM_REGS;
+    }
+    tlc->pointer = reg;
+    return ESP_OK;
+}
+
+static esp_err_t fake_tlc_read(host_i2c_device_t *dev, uint8_t *data, size_t len)
+{
+    fake_tlc_t *tlc = dev->ctx;
+    for (size_t i = 0; i < len; i++) data[i] = tlc->regs[tlc->pointer];
+    return ESP_OK;
+}
+
+static fake_tlc_t chip;
+static i2c_master_dev_handle_t legacy_dev;
+
+static void start_chip(void)
+{
+    host_i2c_reset();
+    memset(&chip, 0, sizeof(chip));
+    chip.dev = (host_i2c_device_t){.address = TLC_ADDR, .write = fake_tlc_write, .read = fake_tlc_read,
+                                   .ctx = &chip};
+    host_i2c_attach(&chip.dev);
+
+    static bool initialised;
+    if (!initialised) {
+        i2c_device_config_t cfg = {.device_address = TLC_ADDR, .scl_speed_hz = 100000};
+        i2c_master_bus_add_device(NULL, &cfg, &legacy_dev);
+        initialised = true;
+    }
+    CHECK_EQ(tlc59108_init(NULL), ESP_OK);
+    tlc59108_reset_stats();
+}
+
+// The colour path before the burst writes: float CT split, then one two-byte write per channel
+static void legacy_colour_change(uint16_t brightness, uint16_t mired)
+{
+    static const uint8_t amber_channels[] = {0, 1, 2};
+    static const uint8_t white_channels[] = {3, 4, 5};
+
+    float kelvin = 1000000.0f / (float)mired;
+    if (kelvin < 2200.0f) kelvin = 2200.0f;
+    if (kelvin > 5000.0f) kelvin = 5000.0f;
+    float white = (kelvin - 2200.0f) / (5000.0f - 2200.0f);
+    uint8_t amber_pwm = (uint16_t)(brightness * (1.0f - white));
+    uint8_t white_pwm = (uint16_t)(brightness * white);
+
+    for (int i = 0; i < 3; i++) {
+        uint8_t data[2] = {REG_PWM0 + amber_channels[i], amber_pwm};
+        i2c_master_transmit(legacy_dev, data, sizeof(data), -1);
+    }
+    for (int i = 0; i < 3; i++) {
+        uint8_t data[2] = {REG_PWM0 + white_channels[i], white_pwm};
+        i2c_master_transmit(legacy_dev, data, sizeof(data), -1);
+    }
+}
+
+#define COLOUR_CHANGES ((455 - 200) / 5 + 1)
+
+// user-001: bus cost of a colour change, six single writes before, one burst now
+static void test_colour_change_transactions(void)
+{
+    start_chip();
+    tlc_set_dither_enabled(false);
+    led_apply_brightness_and_ct(200, 455);
+    host_i2c_reset();
+    host_i2c_attach(&chip.dev);
+    for (uint16_t mired = 200; mired <= 455; mired += 5) legacy_colour_change(200, mired);
+    uint32_t legacy_transactions = host_i2c_transactions;
+    uint32_t legacy_bytes = host_i2c_bytes;
+
+    led_apply_brightness_and_ct(200, 455);
+    host_i2c_reset();
+    host_i2c_attach(&chip.dev);
+    tlc59108_reset_stats();
+    for (uint16_t mired = 200; mired <= 455; mired += 5) {
+        uint32_t before = host_i2c_transactions;
+        led_apply_brightness_and_ct(200, mired);
+        CHECK(host_i2c_transactions - before <= 1);
+    }
+    tlc59108_stats_t stats;
+    tlc59108_get_stats(&stats);
+
+    printf("colour change, per change: before %.2f transactions / %.2f bytes on the wire, "
+           "now %.2f / %.2f (%.2f payload bytes)\n",
+           (double)legacy_transactions / COLOUR_CHANGES, (double)legacy_bytes / COLOUR_CHANGES,
+           (double)host_i2c_transactions / COLOUR_CHANGES, (double)host_i2c_bytes / COLOUR_CHANGES,
+           (double)stats.bytes / COLOUR_CHANGES);
+    CHECK_EQ(legacy_transactions, 6 * COLOUR_CHANGES);
+    CHECK_EQ(stats.transactions, host_i2c_transactions);
+    CHECK(host_i2c_bytes <= 8 * COLOUR_CHANGES);   // address, control byte, PWM0..PWM5
+
+    // The chip ends up with the mix the driver computed
+    for (int ch = 0; ch < TLC_NUM_CHANNELS; ch++) {
+        CHECK_EQ(chip.regs[REG_PWM0 + ch], tlc_get_effective_duty(ch) >> 8);
+    }
+    tlc_set_dither_enabled(true);
+}
+
+// user-002: a level slider dragged up and back; Zigbee repeats a value while the finger rests
+static void test_slider_write_counters(void)
+{
+    start_chip();
+    tlc_set_dither_enabled(false);
+    led_apply_brightness_and_ct(100, 300);
+    tlc59108_reset_stats();
+    host_i2c_reset();
+    host_i2c_attach(&chip.dev);
+
+    int events = 0;
+    for (int level = 100; level <= 160; level += 2) {
+        for (int repeat = 0; repeat < 3; repeat++, events++) led_apply_brightness_and_ct(level, 300);
+    }
+    for (int level = 160; level >= 100; level -= 4, events++) led_apply_brightness_and_ct(level, 300);
+
+    tlc59108_stats_t stats;
+    tlc59108_get_stats(&stats);
+    printf("slider, %d events: %lu register writes issued, %lu suppressed, %lu transactions, %lu bytes "
+           "(uncached: %d writes / transactions)\n",
+           events, (unsigned long)stats.writes_issued, (unsigned long)stats.writes_suppressed,
+           (unsigned long)stats.transactions, (unsigned long)stats.bytes, events * 6);
+
+    // Every write of a register is either issued or suppressed, and only changes reach the chip
+    CHECK_EQ(stats.writes_issued + stats.writes_suppressed, events * TLC_NUM_CHANNELS);
+    CHECK(stats.transactions <= 31 + 15);           // at most one burst per distinct value
+    CHECK_EQ(stats.transactions, host_i2c_transactions);
+    CHECK_EQ(stats.bytes, host_i2c_bytes - host_i2c_transactions);   // all but the address bytes
+    CHECK(chip.pwm_writes >= stats.writes_issued);  // plus clean registers bridged inside a burst
+
+    // A value the chip already has sends nothing at all
+    tlc59108_reset_stats();
+    uint32_t transactions = host_i2c_transactions;
+    for (int repeat = 0; repeat < 10; repeat++) led_apply_brightness_and_ct(100, 300);
+    tlc59108_get_stats(&stats);
+    CHECK_EQ(host_i2c_transactions, transactions);
+    CHECK_EQ(stats.writes_issued, 0);
+    CHECK_EQ(stats.writes_suppressed, 10 * TLC_NUM_CHANNELS);
+
+    uint8_t raw[] = {0, 1, 2};
+    tlc59108_set_group_pwm(raw, sizeof(raw), 42);
+    transactions = host_i2c_transactions;
+    tlc59108_set_group_pwm(raw, sizeof(raw), 42);
+    CHECK_EQ(host_i2c_transactions, transactions);
+    tlc_set_dither_enabled(true);
+}
+
+#define FRAME_HZ 100
+#define LEVEL_MAX_ZB 254
+
+// One minute of led_task frames with breathing on; returns the transactions it cost
+static uint32_t breathe_minute(tlc_effect_mode_t mode, uint16_t *min_duty, uint16_t *max_duty, int *levels)
+{
+    start_chip();
+    tlc_set_dither_enabled(false);
+    led_apply_brightness_and_ct(200, 300);
+    tlc_set_effect_mode(mode);
+    tlc_breathe_init(0.5f);
+    host_i2c_reset();
+    host_i2c_attach(&chip.dev);
+
+    static uint8_t seen[0x10000];
+    memset(seen, 0, sizeof(seen));
+    *min_duty = 0xFFFF;
+    *max_duty = 0;
+    *levels = 0;
+    for (int frame = 0; frame < 60 * FRAME_HZ; frame++) {
+        tlc_breathe_update(1.0f / FRAME_HZ);
+        uint16_t duty = tlc_get_effective_duty(0);
+        if (duty < *min_duty) *min_duty = duty;
+        if (duty > *max_duty) *max_duty = duty;
+        if (!seen[duty]) {
+            seen[duty] = 1;
+            (*levels)++;
+        }
+    }
+    uint32_t transactions = host_i2c_transactions;
+    uint32_t bytes = host_i2c_bytes;
+
+    tlc_set_breathing_enabled(false);
+    tlc_set_effect_mode(TLC_EFFECT_HARDWARE);
+    printf("breathing 0.5 Hz, %s: %lu transactions / %lu bytes per minute, %d distinct duty steps\n",
+           mode == TLC_EFFECT_HARDWARE ? "hardware" : "software", (unsigned long)transactions,
+           (unsigned long)bytes, *levels);
+    return transactions;
+}
+
+// user-003: bus cost per minute of each effect mode, and hardware breathing is a ramp, not a blink
+static void test_effect_modes(void)
+{
+    uint16_t sw_min, sw_max, hw_min, hw_max;
+    int sw_levels, hw_levels;
+    uint32_t sw = breathe_minute(TLC_EFFECT_SOFTWARE, &sw_min, &sw_max, &sw_levels);
+    uint32_t hw = breathe_minute(TLC_EFFECT_HARDWARE, &hw_min, &hw_max, &hw_levels);
+
+    CHECK(sw <= 60 * FRAME_HZ && hw <= 60 * FRAME_HZ);   // at most one write per frame
+    CHECK(hw_levels > 2 * sw_levels);       // a ramp, finer than the software waveform
+    CHECK(hw_min < 0x0200 && sw_min < 0x0200);
+    CHECK(hw_max > 0x6000 && sw_max > 0x6000);   // both peak near PWM 100
+
+    // Identify blinks on the chip's own engine: PWM0..5 plus MODE2 and GRPPWM..LEDOUT1 to start,
+    // nothing while it runs
+    start_chip();
+    led_apply_brightness_and_ct(200, 300);
+    host_i2c_reset();
+    host_i2c_attach(&chip.dev);
+    tlc_identify_start();
+    uint32_t start = host_i2c_transactions;
+    for (int frame = 0; frame < 60 * FRAME_HZ; frame++) tlc_breathe_update(1.0f / FRAME_HZ);
+    CHECK(start <= 2);
+    CHECK_EQ(host_i2c_transactions, start);
+    printf("identify blink: %lu transactions per minute\n", (unsigned long)host_i2c_transactions);
+
+    // Stopping an effect puts the current level back on the chip, with or without a frame
+    // arriving while it ran
+    tlc_identify_stop();
+    uint8_t expected[TLC_NUM_CHANNELS];
+    for (int ch = 0; ch < TLC_NUM_CHANNELS; ch++) expected[ch] = chip.regs[REG_PWM0 + ch];
+    tlc_identify_start();
+    tlc_identify_stop();
+    for (int ch = 0; ch < TLC_NUM_CHANNELS; ch++) CHECK_EQ(chip.regs[REG_PWM0 + ch], expected[ch]);
+    CHECK(expected[0] != 255);
+
+    tlc_identify_start();
+    led_apply_brightness_and_ct(50, 400);
+    CHECK_EQ(chip.regs[REG_PWM0], 255);          // the blink keeps the chip while it runs
+    tlc_identify_stop();
+    led_apply_brightness_and_ct(50, 400);        // same frame again: nothing to send
+    for (int ch = 0; ch < TLC_NUM_CHANNELS; ch++) {
+        CHECK_EQ(chip.regs[REG_PWM0 + ch], tlc_get_effective_duty(ch) >> 8);
+    }
+    CHECK(chip.regs[REG_PWM0] < expected[0]);
+    tlc_set_dither_enabled(true);
+}
+
+#define REFRESH_SECONDS 10
+
+// led_task's refresh loop for REFRESH_SECONDS at a fixed light state: TLC_DITHER_REFRESH_HZ
+// wake-ups while tlc_dither_active(), frame-rate wake-ups from the FreeRTOS tick otherwise
+static void refresh_load(const char *name, uint16_t level, uint16_t mired, bool expect_dither)
+{
+    start_chip();
+    led_apply_brightness_and_ct(level, mired);
+    host_i2c_reset();
+    host_i2c_attach(&chip.dev);
+
+    uint32_t wakes = 0;
+    bool running = true;
+    int ticks_per_frame = TLC_DITHER_REFRESH_HZ / FRAME_HZ;
+    for (int tick = 0; tick < REFRESH_SECONDS * TLC_DITHER_REFRESH_HZ; tick++) {
+        bool frame = tick % ticks_per_frame == 0;
+        if (!running && !frame) continue;
+        wakes++;
+        tlc_dither_tick();
+        if (frame) running = tlc_dither_active();
+    }
+    CHECK_EQ(running, expect_dither);
+
+    printf("refresh, %s: %lu wake-ups/s, %lu transactions/s, %lu bytes/s on the wire (%.1f%% of 100 kHz)\n",
+           name, (unsigned long)(wakes / REFRESH_SECONDS),
+           (unsigned long)(host_i2c_transactions / REFRESH_SECONDS),
+           (unsigned long)(host_i2c_bytes / REFRESH_SECONDS), host_i2c_busy_us / (REFRESH_SECONDS * 1e4));
+    if (!expect_dither) {
+        CHECK_EQ(host_i2c_transactions, 0);
+        CHECK_EQ(wakes, REFRESH_SECONDS * FRAME_HZ);
+    }
+}
+
+// user-007: the 400 Hz refresh only runs, and only touches the bus, while there is a fraction
+static void test_refresh_idle(void)
+{
+    refresh_load("off", 0, 300, false);
+    refresh_load("full, 200 mired", LEVEL_MAX_ZB, 200, false);
+    refresh_load("level 10, 420 mired", 10, 420, true);
+    refresh_load("level 128, 300 mired", 128, 300, true);
+}
+
+static int group_total(int first)
+{
+    return chip.regs[REG_PWM0 + first] + chip.regs[REG_PWM0 + first + 1] + chip.regs[REG_PWM0 + first + 2];
+}
+
+// user-008: in spread mode a group's total output never drops as the level rises, per frame
+// without dither and averaged over the dither pattern with it, and reaches 3 x 255
+static void test_spread_monotonic(void)
+{
+    static const uint16_t mireds[] = {200, 300, 370, 455};
+    start_chip();
+    tlc_set_level_curve(TLC_CURVE_LINEAR);
+    tlc_set_group_alloc(TLC_ALLOC_SPREAD);
+
+    for (int dither = 0; dither <= 1; dither++) {
+        tlc_set_dither_enabled(dither);
+        int frames = dither ? TLC_DITHER_REFRESH_HZ / TLC_DITHER_MIN_PATTERN_HZ : 1;
+        for (size_t m = 0; m < sizeof(mireds) / sizeof(mireds[0]); m++) {
+            int prev_amber = 0, prev_white = 0, prev_sum = 0, drops = 0;
+            for (uint32_t level_q8 = 0; level_q8 <= LEVEL_MAX_ZB << 8; level_q8 += 7) {
+                led_apply_level_q8_and_ct((uint16_t)level_q8, mireds[m]);
+                int amber = 0, white = 0;
+                for (int f = 0; f < frames; f++) {
+                    if (f > 0) tlc_dither_tick();
+                    amber += group_total(0);
+                    white += group_total(3);
+                }
+                if (amber < prev_amber || white < prev_white || amber + white < prev_sum) drops++;
+                prev_amber = amber;
+                prev_white = white;
+                prev_sum = amber + white;
+            }
+            CHECK_EQ(drops, 0);
+        }
+    }
+
+    led_apply_level_q8_and_ct(LEVEL_MAX_ZB << 8, 200);
+    CHECK_EQ(group_total(3), 3 * 255);
+
+    tlc_set_level_curve(TLC_DEFAULT_LEVEL_CURVE);
+    tlc_set_group_alloc(TLC_DEFAULT_GROUP_ALLOC);
+    tlc_set_dither_enabled(true);
+}
+
+int main(void)
+{
+    test_colour_change_transactions();
+    test_slider_write_counters();
+    test_effect_modes();
+    test_refresh_idle();
+    test_spread_monotonic();
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,109 @@
+// Rejoin policy (zb_rejoin.c): the stages a lost lamp walks through, with the channel masks and
+// extended PAN ID each steering attempt hands to the stack, and the persisted network in RAM NVS
+#include "host_test.h"
+#include "host_fakes.h"
+#include "host_zigbee.h"
+#include "zb_rejoin.h"
+#include "freertos/task.h"
+#include <string.h>
+
+#define LAST_CHANNEL 20
+
+static const esp_zb_ieee_addr_t last_pan = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88};
+static const esp_zb_ieee_addr_t any_pan = {0};
+
+// The Zigbee task: runs the backoff alarms the policy schedules
+static void zb_loop(void *arg)
+{
+    esp_zb_stack_main_loop();
+}
+
+// Report the running attempt as failed and run until the next one has started
+static void fail_attempt(void)
+{
+    uint32_t starts = host_zb_commissioning.starts;
+    zb_rejoin_failed();
+    host_task_run(host_time_us + (ZB_REJOIN_BACKOFF_MAX_MS + 1000) * 1000LL);
+    CHECK_EQ(host_zb_commissioning.starts, starts + 1);
+}
+
+static void check_attempt(uint8_t mode, uint32_t mask, const esp_zb_ieee_addr_t ext_pan_id)
+{
+    CHECK_EQ(host_zb_commissioning.mode, mode);
+    if (mode != ESP_ZB_BDB_MODE_NETWORK_STEERING) return;
+    CHECK_EQ(host_zb_commissioning.primary, mask);
+    CHECK_EQ(host_zb_commissioning.secondary, mask);
+    CHECK(memcmp(host_zb_commissioning.ext_pan_id, ext_pan_id, sizeof(esp_zb_ieee_addr_t)) == 0);
+}
+
+// A commissioned lamp that lost its network: stored info, the last channel and PAN, the common
+// channels, then everything, ZB_REJOIN_ATTEMPTS_PER_STAGE attempts each
+static void test_commissioned_stages(void)
+{
+    // Joined once on channel 20, then rebooted
+    host_zb_channel = LAST_CHANNEL;
+    memcpy(host_zb_ext_pan_id, last_pan, sizeof(last_pan));
+    zb_rejoin_succeeded();
+    zb_rejoin_init();
+    CHECK(zb_rejoin_has_network());
+
+    zb_rejoin_begin(true);
+    const uint32_t preferred = ZB_REJOIN_PREFERRED_CHANNELS | (1UL << LAST_CHANNEL);
+    for (int n = 0; n < ZB_REJOIN_ATTEMPTS_PER_STAGE; n++) {
+        if (n > 0) fail_attempt();
+        check_attempt(ESP_ZB_BDB_MODE_INITIALIZATION, 0, any_pan);
+    }
+    for (int n = 0; n < ZB_REJOIN_ATTEMPTS_PER_STAGE; n++) {
+        fail_attempt();
+        check_attempt(ESP_ZB_BDB_MODE_NETWORK_STEERING, 1UL << LAST_CHANNEL, last_pan);
+    }
+    for (int n = 0; n < ZB_REJOIN_ATTEMPTS_PER_STAGE; n++) {
+        fail_attempt();
+        check_attempt(ESP_ZB_BDB_MODE_NETWORK_STEERING, preferred, any_pan);
+    }
+    // The last stage repeats for as long as it takes
+    for (int n = 0; n < 3 * ZB_REJOIN_ATTEMPTS_PER_STAGE; n++) {
+        fail_attempt();
+        check_attempt(ESP_ZB_BDB_MODE_NETWORK_STEERING, ESP_ZB_TRANSCEIVER_ALL_CHANNELS_MASK, any_pan);
+    }
+
+    zb_rejoin_succeeded();
+    zb_rejoin_stats_t stats;
+    zb_rejoin_get_stats(&stats);
+    CHECK_EQ(stats.last_stage, ZB_REJOIN_STAGE_ALL);
+    CHECK_EQ(stats.last_attempts, 6 * ZB_REJOIN_ATTEMPTS_PER_STAGE);
+    CHECK_EQ(stats.channel, LAST_CHANNEL);
+}
+
+// A factory-new lamp has no stored network and nothing persisted: steering only
+static void test_factory_new_stages(void)
+{
+    zb_rejoin_forget();
+    zb_rejoin_init();
+    CHECK(!zb_rejoin_has_network());
+
+    zb_rejoin_begin(false);
+    for (int n = 0; n < ZB_REJOIN_ATTEMPTS_PER_STAGE; n++) {
+        if (n > 0) fail_attempt();
+        check_attempt(ESP_ZB_BDB_MODE_NETWORK_STEERING, ZB_REJOIN_PREFERRED_CHANNELS, any_pan);
+    }
+    fail_attempt();
+    check_attempt(ESP_ZB_BDB_MODE_NETWORK_STEERING, ESP_ZB_TRANSCEIVER_ALL_CHANNELS_MASK, any_pan);
+
+    zb_rejoin_succeeded();
+    zb_rejoin_stats_t stats;
+    zb_rejoin_get_stats(&stats);
+    CHECK_EQ(stats.last_stage, ZB_REJOIN_STAGE_ALL);
+}
+
+int main(void)
+{
+    host_nvs_enabled = true;
+    host_nvs_reset();
+    xTaskCreate(zb_loop, "Zigbee_main", 4096, NULL, 5, NULL);
+    host_task_run(host_time_us);
+
+    test_commissioned_stages();
+    test_factory_new_stages();
+    return HOST_TEST_RESULT();
+}
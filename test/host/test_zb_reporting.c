@@ -0,0 +1,182 @@
+// Report coalescing (zb_reporting.c) against the reporting engine of the Zigbee fake: a commanded
+// transition the stack steps through, hub configuration during a burst and the send-status chain
+#include "host_test.h"
+#include "host_fakes.h"
+#include "host_zigbee.h"
+#include "zigbee_app.h"
+#include "zb_reporting.h"
+#include "light_store.h"
+#include "freertos/task.h"
+
+#define LEVEL_CLUSTER  ESP_ZB_ZCL_CLUSTER_ID_LEVEL_CONTROL
+#define LEVEL_ATTR     ESP_ZB_ZCL_ATTR_LEVEL_CONTROL_CURRENT_LEVEL_ID
+#define MIRED_CLUSTER  ESP_ZB_ZCL_CLUSTER_ID_COLOR_CONTROL
+#define MIRED_ATTR     ESP_ZB_ZCL_ATTR_COLOR_CONTROL_COLOR_TEMPERATURE_ID
+#define ON_OFF_CLUSTER ESP_ZB_ZCL_CLUSTER_ID_ON_OFF
+#define ON_OFF_ATTR    ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID
+
+#define STEP_US        100000   // the stack steps a transition ten times a second
+
+static uint32_t chained_sent;
+
+static void chained_send_status(esp_zb_zcl_command_send_status_message_t message)
+{
+    if (message.status == ESP_OK) chained_sent++;
+}
+
+static void set_attr(uint16_t cluster, uint16_t attr, uint8_t type, uint8_t size, void *value)
+{
+    esp_zb_zcl_set_attr_value_message_t msg = {
+        .info = {.status = ESP_ZB_ZCL_STATUS_SUCCESS, .dst_endpoint = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT,
+                 .cluster = cluster},
+        .attribute = {.id = attr, .data = {type, size, value}},
+    };
+    CHECK_EQ(host_zb_action(ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID, &msg), ESP_OK);
+}
+
+static void set_level(uint8_t level)
+{
+    set_attr(LEVEL_CLUSTER, LEVEL_ATTR, ESP_ZB_ZCL_ATTR_TYPE_U8, 1, &level);
+}
+
+static void set_mired(uint16_t value)
+{
+    set_attr(MIRED_CLUSTER, MIRED_ATTR, ESP_ZB_ZCL_ATTR_TYPE_U16, 2, &value);
+}
+
+// A Move to Level (with On/Off) command with its transition, stepped by the stack as it runs
+static void move_to_level(uint8_t from, uint8_t to, uint16_t transition_ds)
+{
+    zb_zcl_parsed_hdr_t hdr = {
+        .cluster_id = LEVEL_CLUSTER,
+        .cmd_id = ESP_ZB_ZCL_CMD_LEVEL_CONTROL_MOVE_TO_LEVEL_WITH_ON_OFF,
+        .addr_data.common_data.dst_endpoint = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT,
+    };
+    uint8_t payload[3] = {to, (uint8_t)transition_ds, (uint8_t)(transition_ds >> 8)};
+    CHECK(!host_zb_raw_command(&hdr, payload, sizeof(payload)));
+
+    int steps = transition_ds * 100000 / STEP_US;
+    for (int k = 1; k <= steps; k++) {
+        host_task_run(host_time_us + STEP_US);
+        set_level((uint8_t)(from + (to - from) * k / steps));
+    }
+}
+
+static esp_zb_zcl_reporting_info_t *level_reporting(void)
+{
+    esp_zb_zcl_attr_location_info_t location = {
+        .endpoint_id = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT,
+        .cluster_id = LEVEL_CLUSTER,
+        .cluster_role = ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        .manuf_code = ESP_ZB_ZCL_ATTR_NON_MANUFACTURER_SPECIFIC,
+        .attr_id = LEVEL_ATTR,
+    };
+    return esp_zb_zcl_find_reporting_info(location);
+}
+
+// A one second transition: one report with the final value, after the fade and the settle time
+static void test_transition_reports_once(void)
+{
+    uint32_t level_reports = host_zb_reports_for(LEVEL_CLUSTER, LEVEL_ATTR);
+    uint32_t on_off_reports = host_zb_reports_for(ON_OFF_CLUSTER, ON_OFF_ATTR);
+    uint32_t reports = host_zb_reports;
+    int64_t start = host_time_us;
+
+    move_to_level(128, 200, 10);
+    host_task_run(start + 5 * 1000000);
+
+    CHECK_EQ(host_zb_reports_for(LEVEL_CLUSTER, LEVEL_ATTR) - level_reports, 1);
+    CHECK_EQ(host_zb_reports_for(ON_OFF_CLUSTER, ON_OFF_ATTR), on_off_reports);
+    CHECK_EQ(host_zb_reports - reports, 1);
+    int64_t sent_at = host_zb_report_log[reports] - start;
+    CHECK(sent_at >= (1000 + LIGHT_REPORT_SETTLE_MS) * 1000);
+    CHECK(sent_at <= (1000 + LIGHT_REPORT_SETTLE_MS + 2 * portTICK_PERIOD_MS) * 1000);
+    CHECK_EQ(level_reporting()->u.send_info.reported_value.u8, 200);
+
+    // The hub's configuration is back in force
+    CHECK_EQ(level_reporting()->u.send_info.min_interval, LIGHT_REPORT_MIN_S);
+    CHECK_EQ(level_reporting()->u.send_info.max_interval, LIGHT_REPORT_MAX_S);
+    printf("1 s transition, %d steps: %lu report(s), %lld ms after the command\n", 10,
+           (unsigned long)(host_zb_reports - reports), (long long)(sent_at / 1000));
+}
+
+// A burst that ends where it started reports nothing
+static void test_round_trip_reports_nothing(void)
+{
+    uint32_t reports = host_zb_reports;
+    set_level(190);
+    host_task_run(host_time_us + STEP_US);
+    set_level(200);
+    host_task_run(host_time_us + 5 * 1000000);
+    CHECK_EQ(host_zb_reports, reports);
+}
+
+// A Configure Reporting from the hub during the burst stays in force
+static void test_hub_configuration_kept(void)
+{
+    uint32_t reports = host_zb_reports;
+    set_level(100);
+
+    esp_zb_zcl_reporting_info_t hub = *level_reporting();
+    hub.u.send_info.min_interval = 5;
+    hub.u.send_info.max_interval = 300;
+    CHECK_EQ(esp_zb_zcl_update_reporting_info(&hub), ESP_OK);
+
+    host_task_run(host_time_us + 10 * 1000000);
+    CHECK_EQ(level_reporting()->u.send_info.min_interval, 5);
+    CHECK_EQ(level_reporting()->u.send_info.max_interval, 300);
+    CHECK_EQ(host_zb_reports - reports, 1);
+    CHECK_EQ(level_reporting()->u.send_info.reported_value.u8, 100);
+}
+
+// Reporting the hub turned off is neither paused nor turned back on
+static void test_disabled_reporting_left_alone(void)
+{
+    esp_zb_zcl_attr_location_info_t location = {
+        .endpoint_id = HA_COLOR_DIMMABLE_LIGHT_ENDPOINT,
+        .cluster_id = MIRED_CLUSTER,
+        .cluster_role = ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+        .manuf_code = ESP_ZB_ZCL_ATTR_NON_MANUFACTURER_SPECIFIC,
+        .attr_id = MIRED_ATTR,
+    };
+    esp_zb_zcl_reporting_info_t off = *esp_zb_zcl_find_reporting_info(location);
+    off.u.send_info.max_interval = 0xFFFF;
+    CHECK_EQ(esp_zb_zcl_update_reporting_info(&off), ESP_OK);
+
+    light_report_stats_t before, after;
+    light_reporting_get_stats(&before);
+    uint32_t mired_reports = host_zb_reports_for(MIRED_CLUSTER, MIRED_ATTR);
+    set_mired(300);
+    host_task_run(host_time_us + 5 * 1000000);
+    light_reporting_get_stats(&after);
+
+    CHECK_EQ(after.bursts - before.bursts, 1);
+    CHECK_EQ(after.holds - before.holds, 2);     // on/off and level, not the colour temperature
+    CHECK_EQ(esp_zb_zcl_find_reporting_info(location)->u.send_info.max_interval, 0xFFFF);
+    CHECK_EQ(host_zb_reports_for(MIRED_CLUSTER, MIRED_ATTR), mired_reports);
+}
+
+int main(void)
+{
+    light_store_start(false);
+    xTaskCreate(esp_zb_task, "Zigbee_main", 4096, NULL, 5, NULL);
+    host_task_run(host_time_us);
+    CHECK_EQ(zigbee_send_status_handler_add(chained_send_status), ESP_OK);
+
+    // Settle the start-up values, then leave the min interval behind
+    set_level(128);
+    host_task_run(host_time_us + 5 * 1000000);
+
+    test_transition_reports_once();
+    test_round_trip_reports_nothing();
+    test_hub_configuration_kept();
+    test_disabled_reporting_left_alone();
+
+    // Every report went through the dispatcher and on to the chained handler
+    zigbee_send_stats_t sends;
+    zigbee_get_send_stats(&sends);
+    CHECK_EQ(sends.sent, host_zb_reports);
+    CHECK_EQ(sends.failed, 0);
+    CHECK_EQ(chained_sent, host_zb_reports);
+    return HOST_TEST_RESULT();
+}